@@ -0,0 +1,216 @@
+#ifndef IMPL_ANY_RANGE_HPP_
+#define IMPL_ANY_RANGE_HPP_
+
+#include "impl.hpp"
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace ddw
+{
+
+namespace detail
+{
+
+template<typename Ref>
+struct any_iterator_base
+{
+  using value_type = std::remove_cv_t<std::remove_reference_t<Ref>>;
+
+  virtual ~any_iterator_base() {}
+  virtual bool done() const = 0;
+  virtual Ref current() = 0;
+  virtual void advance() = 0;
+  virtual std::size_t next_n(value_type* out, std::size_t max) = 0;
+};
+
+template<typename Ref, typename It, typename End>
+struct any_iterator_model : any_iterator_base<Ref>
+{
+  using value_type = typename any_iterator_base<Ref>::value_type;
+
+  any_iterator_model(It it, End end) : it(std::move(it)), end(std::move(end)) {}
+
+  bool done() const override
+  {
+    return not (it != end);
+  }
+
+  Ref current() override
+  {
+    return *it;
+  }
+
+  void advance() override
+  {
+    ++it;
+  }
+
+  std::size_t next_n(value_type* out, std::size_t max) override
+  {
+    std::size_t n = 0;
+    // Always instantiated since it is virtual; any_iterator::next_n rejects
+    // elements that cannot be copied.
+    if constexpr (std::is_copy_assignable_v<value_type>)
+      for (; n < max and it != end; ++it)
+        out[n++] = *it;
+    return n;
+  }
+
+  It it;
+  End end;
+};
+
+}
+
+struct any_sentinel {};
+
+// Type-erased forward iterator, together with its end, yielding Ref. The
+// concrete iterators are stored inline in Capacity bytes (which also hold a
+// vptr); ones that do not fit are rejected at compile time. Stepping costs a
+// virtual call per operation; next_n() copies up to max elements in a single
+// virtual call instead, if value_type is copy-assignable.
+template<typename Ref, std::size_t Capacity = 32>
+class any_iterator
+{
+public:
+  using value_type = typename detail::any_iterator_base<Ref>::value_type;
+  using reference = Ref;
+
+  any_iterator() = default;
+
+  template<typename It, typename End>
+  any_iterator(It it, End end)
+  {
+    d.template emplace_small<detail::any_iterator_model<Ref, It, End>>(std::move(it), std::move(end));
+    p = d.get();
+  }
+
+  any_iterator(any_iterator&& other) : d(std::move(other.d)), p(d.get()) {}
+
+  any_iterator& operator=(any_iterator&& other)
+  {
+    d = std::move(other.d);
+    p = d.get();
+    return *this;
+  }
+
+  bool done() const
+  {
+    return not p or p->done();
+  }
+
+  Ref operator*()
+  {
+    return p->current();
+  }
+
+  any_iterator& operator++()
+  {
+    p->advance();
+    return *this;
+  }
+
+  // Copies up to max elements to out and returns how many; 0 means done.
+  std::size_t next_n(value_type* out, std::size_t max)
+  {
+    static_assert(std::is_copy_assignable_v<value_type>, "next_n cannot copy the elements");
+    return p ? p->next_n(out, max) : 0;
+  }
+
+  friend bool operator!=(const any_iterator& i, any_sentinel)
+  {
+    return not i.done();
+  }
+
+  friend bool operator==(const any_iterator& i, any_sentinel)
+  {
+    return i.done();
+  }
+
+private:
+  impl<detail::any_iterator_base<Ref>, Capacity> d;
+  // Cached d.get(), saving the storage dispatch on every step.
+  detail::any_iterator_base<Ref>* p = nullptr;
+};
+
+namespace detail
+{
+
+template<typename Ref, std::size_t Capacity>
+struct any_range_base
+{
+  virtual ~any_range_base() {}
+  virtual any_iterator<Ref, Capacity> begin() = 0;
+};
+
+template<typename Ref, std::size_t Capacity, typename R>
+struct any_range_value : any_range_base<Ref, Capacity>
+{
+  template<typename S>
+  any_range_value(S&& r) : r(std::forward<S>(r)) {}
+
+  any_iterator<Ref, Capacity> begin() override
+  {
+    using std::begin;
+    using std::end;
+    return {begin(r), end(r)};
+  }
+
+  R r;
+};
+
+template<typename Ref, std::size_t Capacity, typename R>
+struct any_range_reference : any_range_base<Ref, Capacity>
+{
+  any_range_reference(R& r) : r(&r) {}
+
+  any_iterator<Ref, Capacity> begin() override
+  {
+    using std::begin;
+    using std::end;
+    return {begin(*r), end(*r)};
+  }
+
+  R* r;
+};
+
+}
+
+// Type-erased range yielding Ref, stored inline like its iterators: lvalue
+// ranges (containers) by reference, rvalue ranges (views, generators) by
+// value. begin() never allocates.
+template<typename Ref, std::size_t Capacity = 32>
+class any_range
+{
+public:
+  using iterator = any_iterator<Ref, Capacity>;
+
+  any_range() = default;
+
+  template<typename R, typename = std::enable_if_t<not std::is_same_v<std::decay_t<R>, any_range>>>
+  any_range(R&& r)
+  {
+    if constexpr (std::is_lvalue_reference_v<R>)
+      d.template emplace_small<detail::any_range_reference<Ref, Capacity, std::remove_reference_t<R>>>(r);
+    else
+      d.template emplace_small<detail::any_range_value<Ref, Capacity, std::decay_t<R>>>(std::move(r));
+  }
+
+  iterator begin()
+  {
+    return d ? d->begin() : iterator();
+  }
+
+  any_sentinel end()
+  {
+    return {};
+  }
+
+private:
+  impl<detail::any_range_base<Ref, Capacity>, Capacity> d;
+};
+
+}
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef IMPL_ATOMIC_IMPL_HPP_
+#define IMPL_ATOMIC_IMPL_HPP_
+
+#include "impl.hpp"
+#include "rcu.hpp"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace ddw
+{
+
+// Holder of an impl<T, C, A> that can be replaced while other threads keep
+// using it. Readers enter a read-side section through read() without any
+// atomic read-modify-write; store() publishes a new implementation and
+// destroys the previous one once all readers that could see it are gone.
+// A store() from a thread that holds a guard itself cannot wait for readers,
+// so it only retires the previous implementation, which is destroyed by the
+// next store() made outside a read-side section, or with the atomic_impl.
+template<typename T, std::size_t Capacity = 32, std::size_t Alignment = sizeof(void*)>
+class atomic_impl
+{
+  struct node;
+
+public:
+  using interface_type = T;
+  using value_type = impl<T, Capacity, Alignment>;
+
+  class guard
+  {
+  public:
+    guard(const guard&) = delete;
+
+    ~guard()
+    {
+      detail::rcu_domain::instance().exit(slot);
+    }
+
+    const interface_type& operator*() const
+    {
+      return *ptr;
+    }
+
+    const interface_type* operator->() const
+    {
+      return ptr;
+    }
+
+    explicit operator bool() const
+    {
+      return ptr != nullptr;
+    }
+
+  private:
+    friend class atomic_impl;
+
+    guard(detail::rcu_slot& s, const std::atomic<node*>& current) : slot(s)
+    {
+      detail::rcu_domain::instance().enter(slot);
+      node* n = current.load(std::memory_order_acquire);
+      ptr = n ? n->ptr : nullptr;
+    }
+
+    detail::rcu_slot& slot;
+    const interface_type* ptr;
+  };
+
+  atomic_impl() = default;
+
+  template<typename U>
+  atomic_impl(U&& v) : current(new node(std::forward<U>(v))) {}
+
+  atomic_impl(const atomic_impl&) = delete;
+
+  ~atomic_impl()
+  {
+    for (node* old : retired)
+      delete old;
+    delete current.load(std::memory_order_relaxed);
+  }
+
+  guard read() const
+  {
+    return guard(detail::rcu_domain::instance().local_slot(), current);
+  }
+
+  template<typename U>
+  void store(U&& v)
+  {
+    publish(new node(std::forward<U>(v)));
+  }
+
+  template<typename U, typename... Args>
+  void emplace(Args&&... args)
+  {
+    node* n = new node();
+    n->value.template emplace<U>(std::forward<Args>(args)...);
+    n->ptr = n->value.get();
+    publish(n);
+  }
+
+private:
+  struct node
+  {
+    node() = default;
+
+    template<typename U>
+    node(U&& v) : value(std::forward<U>(v)), ptr(value.get()) {}
+
+    value_type value;
+    const interface_type* ptr = nullptr;
+  };
+
+  // Only swaps current under writer: a reader that stores from its read-side
+  // section may be waiting for writer while synchronize() waits for it.
+  void publish(node* n)
+  {
+    std::vector<node*> reclaimable;
+    {
+      std::lock_guard<std::mutex> lock(writer);
+      retired.push_back(current.exchange(n, std::memory_order_acq_rel));
+      if (not detail::rcu_domain::instance().in_read_section())
+        reclaimable.swap(retired);
+    }
+    if (reclaimable.empty()) return;
+    detail::rcu_domain::instance().synchronize();
+    for (node* old : reclaimable)
+      delete old;
+  }
+
+  std::atomic<node*> current{nullptr};
+  std::mutex writer;
+  std::vector<node*> retired;
+};
+
+}
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef IMPL_CHANNEL_HPP_
+#define IMPL_CHANNEL_HPP_
+
+#if __cplusplus < 202002L
+#error "ddw/channel.hpp requires C++20"
+#endif
+
+#include "impl.hpp"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+
+namespace ddw
+{
+
+namespace detail
+{
+
+// Per-thread free lists of coroutine frames, bucketed by size.
+// A frame freed on another thread than the one that allocated it simply
+// migrates to the pool of the freeing thread.
+struct frame_pool
+{
+  static const std::size_t granularity = 64;
+  static const std::size_t classes = 16;
+  static const std::size_t max_cached = 256;
+
+  struct block
+  {
+    block* next;
+  };
+
+  static void* allocate(std::size_t n)
+  {
+    std::size_t c = size_class(n);
+    if (c >= classes)
+      return ::operator new(n);
+    frame_pool& p = local();
+    if (block* b = p.free[c])
+    {
+      p.free[c] = b->next;
+      p.count[c]--;
+      return b;
+    }
+    return ::operator new(c * granularity);
+  }
+
+  static void deallocate(void* ptr, std::size_t n)
+  {
+    std::size_t c = size_class(n);
+    frame_pool& p = local();
+    if (c >= classes or p.count[c] >= max_cached)
+      return ::operator delete(ptr);
+    block* b = static_cast<block*>(ptr);
+    b->next = p.free[c];
+    p.free[c] = b;
+    p.count[c]++;
+  }
+
+  ~frame_pool()
+  {
+    for (block* b : free)
+      while (b)
+        ::operator delete(std::exchange(b, b->next));
+  }
+
+private:
+  static std::size_t size_class(std::size_t n)
+  {
+    return (n + granularity - 1) / granularity;
+  }
+
+  static frame_pool& local()
+  {
+    thread_local frame_pool p;
+    return p;
+  }
+
+  block* free[classes] = {};
+  std::size_t count[classes] = {};
+};
+
+}
+
+// Base class for promise types whose coroutine frames should be allocated
+// from the per-thread frame pools.
+struct pooled_frame
+{
+  static void* operator new(std::size_t n)
+  {
+    return detail::frame_pool::allocate(n);
+  }
+
+  static void operator delete(void* p, std::size_t n)
+  {
+    detail::frame_pool::deallocate(p, n);
+  }
+};
+
+// Eagerly started coroutine that owns its frame.
+class task
+{
+public:
+  struct promise_type : pooled_frame
+  {
+    task get_return_object()
+    {
+      return task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  task(task&& other) noexcept : h(std::exchange(other.h, {})) {}
+  task(const task&) = delete;
+
+  ~task()
+  {
+    if (h) h.destroy();
+  }
+
+  bool done() const
+  {
+    return h.done();
+  }
+
+private:
+  explicit task(std::coroutine_handle<promise_type> h) : h(h) {}
+
+  std::coroutine_handle<promise_type> h;
+};
+
+// Bounded single-producer single-consumer channel of impl<T, C, A> values.
+// co_await push() suspends the producer while the channel is full, then
+// returns whether the value was pushed (see push_awaiter), and co_await pop()
+// suspends the consumer while it is empty. The other side
+// resumes a suspended peer inline, so no mutex or thread is involved.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*), std::size_t N = 1024>
+class channel
+{
+public:
+  using value_type = impl<T, C, A>;
+
+  template<typename U>
+  struct push_awaiter
+  {
+    channel& ch;
+    U&& v;
+    bool pushed = false;
+
+    bool await_ready()
+    {
+      return pushed = ch.try_push(std::forward<U>(v));
+    }
+
+    // Suspends until there is room; if there already is, pushes right away,
+    // and suspends again should the push lose a race after all.
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+      channel* c = &ch;
+      while (not c->suspend(c->producer, h, [c]() { return not c->full(); }))
+        if ((pushed = c->try_push(std::forward<U>(v))))
+          return false;
+      return true;
+    }
+
+    // Returns whether v was pushed. With a single producer a resumed push
+    // always finds room, so false means that the channel was misused; v is
+    // then left untouched and can be pushed again.
+    bool await_resume()
+    {
+      if (not pushed) pushed = ch.try_push(std::forward<U>(v));
+      return pushed;
+    }
+  };
+
+  struct pop_awaiter
+  {
+    channel& ch;
+
+    bool await_ready()
+    {
+      return not ch.empty();
+    }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+      channel* c = &ch;
+      return c->suspend(c->consumer, h, [c]() { return not c->empty(); });
+    }
+
+    value_type await_resume()
+    {
+      return ch.take();
+    }
+  };
+
+  channel() = default;
+  channel(const channel&) = delete;
+
+  ~channel()
+  {
+    for (std::size_t i = head; i != tail; i++)
+      slot(i)->~value_type();
+  }
+
+  template<typename U>
+  push_awaiter<U> push(U&& v)
+  {
+    return {*this, std::forward<U>(v)};
+  }
+
+  pop_awaiter pop()
+  {
+    return {*this};
+  }
+
+  bool full() const
+  {
+    return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) == N;
+  }
+
+  bool empty() const
+  {
+    return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+  }
+
+  template<typename U>
+  bool try_push(U&& v)
+  {
+    if (full()) return false;
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    new (slot(t)) value_type(std::forward<U>(v));
+    tail.store(t + 1, std::memory_order_release);
+    wake(consumer);
+    return true;
+  }
+
+private:
+  using value_storage = typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type;
+
+  value_type* slot(std::size_t i)
+  {
+    return reinterpret_cast<value_type*>(&slots[i % N]);
+  }
+
+  value_type take()
+  {
+    std::size_t h = head.load(std::memory_order_relaxed);
+    value_type v = std::move(*slot(h));
+    slot(h)->~value_type();
+    head.store(h + 1, std::memory_order_release);
+    wake(producer);
+    return v;
+  }
+
+  // Publishes h as waiter, unless ready() turned true in the meantime. Once
+  // published, h may be resumed by the peer at any time, so nothing that lives
+  // in the awaiting coroutine frame is touched afterwards.
+  template<typename F>
+  static bool suspend(std::atomic<void*>& waiter, std::coroutine_handle<> h, F ready)
+  {
+    waiter.store(h.address(), std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (not ready()) return true;
+    void* expected = h.address();
+    return not waiter.compare_exchange_strong(expected, nullptr);
+  }
+
+  static void wake(std::atomic<void*>& waiter)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiter.load(std::memory_order_relaxed) == nullptr) return;
+    if (void* h = waiter.exchange(nullptr, std::memory_order_acquire))
+      std::coroutine_handle<>::from_address(h).resume();
+  }
+
+  value_storage slots[N];
+  alignas(64) std::atomic<std::size_t> head = 0;
+  alignas(64) std::atomic<std::size_t> tail = 0;
+  alignas(64) std::atomic<void*> consumer = nullptr;
+  alignas(64) std::atomic<void*> producer = nullptr;
+};
+
+}
+
+#endif
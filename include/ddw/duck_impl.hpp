@@ -0,0 +1,270 @@
+#ifndef IMPL_DUCK_IMPL_HPP_
+#define IMPL_DUCK_IMPL_HPP_
+
+#include "impl.hpp"
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ddw
+{
+
+// Base of a method descriptor of a duck-typed interface. A descriptor names
+// the signature and forwards a call to any object that has such a method:
+//
+//   struct print : ddw::method<void(std::ostream&)>
+//   {
+//     template<typename U>
+//     static void call(U& self, std::ostream& os) { self.print(os); }
+//   };
+//
+// DDW_IMPL_METHOD(print, void(std::ostream&)) generates the same descriptor.
+template<typename Signature>
+struct method
+{
+  using signature = Signature;
+};
+
+template<typename... Methods>
+struct interface {};
+
+#define DDW_IMPL_METHOD(Name, ...) \
+  struct Name : ::ddw::method<__VA_ARGS__> \
+  { \
+    template<typename U, typename... Args> \
+    static decltype(auto) call(U& self, Args&&... args) \
+    { \
+      return self.Name(std::forward<Args>(args)...); \
+    } \
+  }
+
+namespace detail
+{
+
+template<typename U>
+struct duck_inline
+{
+  static U& self(void* p) { return *static_cast<U*>(p); }
+  static void move(void* dst, void* src) { new (dst) U(std::move(self(src))); }
+  static void destroy(void* p) { self(p).~U(); }
+};
+
+template<typename U>
+struct duck_heap
+{
+  static U& self(void* p) { return **static_cast<U**>(p); }
+  static void move(void* dst, void* src) { *static_cast<U**>(dst) = std::exchange(*static_cast<U**>(src), nullptr); }
+  static void destroy(void* p) { delete *static_cast<U**>(p); }
+};
+
+template<typename U>
+struct duck_reference
+{
+  static U& self(void* p) { return **static_cast<U**>(p); }
+  static void move(void* dst, void* src) { *static_cast<U**>(dst) = *static_cast<U**>(src); }
+  static void destroy(void*) {}
+};
+
+template<typename M, typename Signature = typename M::signature>
+struct duck_thunk;
+
+template<typename M, typename R, typename... Args>
+struct duck_thunk<M, R(Args...)>
+{
+  using type = R (*)(void*, Args...);
+
+  template<typename Storage>
+  static R call(void* p, Args... args)
+  {
+    return M::call(Storage::self(p), std::forward<Args>(args)...);
+  }
+};
+
+template<typename... Methods>
+struct duck_table
+{
+  void (*move)(void* dst, void* src);
+  void (*destroy)(void* p);
+  std::tuple<typename duck_thunk<Methods>::type...> methods;
+};
+
+template<typename Storage, typename... Methods>
+inline constexpr duck_table<Methods...> duck_table_for = {
+  Storage::move, Storage::destroy, {duck_thunk<Methods>::template call<Storage>...}
+};
+
+// Copies of the method pointers, kept in the holder itself when there are few
+// enough of them; otherwise an empty base, so the holder does not grow.
+template<bool Inline, typename... Methods>
+struct duck_methods
+{
+  std::tuple<typename duck_thunk<Methods>::type...> methods;
+};
+
+template<typename... Methods>
+struct duck_methods<false, Methods...> {};
+
+template<typename M, typename... Methods>
+constexpr std::size_t duck_index()
+{
+  constexpr bool matches[] = {std::is_same_v<M, Methods>...};
+  for (std::size_t i = 0; i < sizeof...(Methods); i++)
+    if (matches[i]) return i;
+  return sizeof...(Methods);
+}
+
+}
+
+template<typename Interface, std::size_t Capacity = 32, std::size_t Alignment = sizeof(void*)>
+class duck_impl;
+
+// Holder of any object that provides the methods of an interface<Methods...>,
+// without requiring a common base class or a vptr in the object. Every stored
+// type gets one static dispatch table; with up to two methods, their function
+// pointers are also copied into the holder so that calls need a single
+// indirection. Objects are stored inline if they fit, on the heap otherwise,
+// or by reference when passed through ddw::impl_by_reference().
+template<typename... Methods, std::size_t Capacity, std::size_t Alignment>
+class duck_impl<interface<Methods...>, Capacity, Alignment>
+  : private detail::duck_methods<(sizeof...(Methods) <= 2), Methods...>
+{
+public:
+  static const std::size_t capacity = Capacity;
+  static const std::size_t alignment = Alignment;
+  static const bool inline_methods = sizeof...(Methods) <= 2;
+  using this_type = duck_impl<interface<Methods...>, capacity, alignment>;
+
+  duck_impl() = default;
+
+  template<typename U, typename = std::enable_if_t<not std::is_same_v<std::decay_t<U>, this_type>>>
+  duck_impl(U&& v)
+  {
+    emplace<std::decay_t<U>>(std::forward<U>(v));
+  }
+
+  template<typename U>
+  duck_impl(detail::impl_forced_value<U>&& v)
+  {
+    emplace<std::decay_t<U>>(std::forward<U>(v.v));
+  }
+
+  template<typename U>
+  duck_impl(detail::impl_forced_small_value<U>&& v)
+  {
+    emplace_small<std::decay_t<U>>(std::forward<U>(v.v));
+  }
+
+  template<typename U, typename = std::enable_if_t<std::is_lvalue_reference_v<U>>>
+  duck_impl(detail::impl_forced_reference<U>&& v)
+  {
+    using impl_type = std::remove_reference_t<U>;
+    *reinterpret_cast<impl_type**>(&value) = &v.v;
+    set_table<detail::duck_reference<impl_type>>();
+  }
+
+  duck_impl(this_type&& other)
+  {
+    take(other);
+  }
+
+  duck_impl(const this_type&) = delete;
+
+  this_type& operator=(this_type&& other)
+  {
+    clear();
+    take(other);
+    return *this;
+  }
+
+  ~duck_impl()
+  {
+    clear();
+  }
+
+  template<typename U, typename... Args>
+  void emplace(Args&&... args)
+  {
+    if constexpr (sizeof(U) <= capacity
+        and alignof(U) <= alignment
+        and std::is_move_constructible_v<U>)
+      emplace_small<U>(std::forward<Args>(args)...);
+    else
+      emplace_big<U>(std::forward<Args>(args)...);
+  }
+
+  template<typename U, typename... Args>
+  void emplace_small(Args&&... args)
+  {
+    static_assert(std::is_move_constructible_v<U>, "U is not move-constructible");
+    static_assert(sizeof(U) <= capacity, "capacity too small to store U");
+    static_assert(alignof(U) <= alignment, "alignment too small to store U");
+    clear();
+    new (&value) U(std::forward<Args>(args)...);
+    set_table<detail::duck_inline<U>>();
+  }
+
+  template<typename U, typename... Args>
+  DDW_IMPL_COLD void emplace_big(Args&&... args)
+  {
+    static_assert(sizeof(U*) <= capacity, "capacity too small to store U");
+    clear();
+    *reinterpret_cast<U**>(&value) = new U(std::forward<Args>(args)...);
+    set_table<detail::duck_heap<U>>();
+  }
+
+  template<typename M, typename... Args>
+  decltype(auto) call(Args&&... args)
+  {
+    constexpr std::size_t i = detail::duck_index<M, Methods...>();
+    static_assert(i < sizeof...(Methods), "M is not a method of the interface");
+    if constexpr (inline_methods)
+      return std::get<i>(this->methods)(&value, std::forward<Args>(args)...);
+    else
+      return std::get<i>(table->methods)(&value, std::forward<Args>(args)...);
+  }
+
+  bool has_impl() const
+  {
+    return table != nullptr;
+  }
+
+  explicit operator bool() const
+  {
+    return has_impl();
+  }
+
+private:
+  using table_type = detail::duck_table<Methods...>;
+  using value_storage = typename std::aligned_storage<capacity, alignment>::type;
+
+  template<typename Storage>
+  void set_table()
+  {
+    table = &detail::duck_table_for<Storage, Methods...>;
+    if constexpr (inline_methods)
+      this->methods = table->methods;
+  }
+
+  void take(this_type& other)
+  {
+    if (not other.table) return;
+    other.table->move(&value, &other.value);
+    table = other.table;
+    if constexpr (inline_methods)
+      this->methods = other.methods;
+  }
+
+  void clear()
+  {
+    if (not table) return;
+    table->destroy(&value);
+    table = nullptr;
+  }
+
+  const table_type* table = nullptr;
+  value_storage value;
+};
+
+}
+
+#endif
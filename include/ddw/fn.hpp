@@ -0,0 +1,131 @@
+#ifndef IMPL_FN_HPP_
+#define IMPL_FN_HPP_
+
+#include "impl.hpp"
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace ddw
+{
+
+namespace detail
+{
+
+template<typename R, typename... Args>
+struct fn_callable
+{
+  virtual ~fn_callable() {}
+  virtual R call(Args... args) = 0;
+};
+
+template<typename F, typename R, typename... Args>
+struct fn_value : fn_callable<R, Args...>
+{
+  template<typename G>
+  fn_value(G&& g) : f(std::forward<G>(g)) {}
+
+  R call(Args... args) override
+  {
+    return std::invoke(f, std::forward<Args>(args)...);
+  }
+
+  F f;
+};
+
+template<typename F, typename R, typename... Args>
+struct fn_reference : fn_callable<R, Args...>
+{
+  fn_reference(F& f) : f(&f) {}
+
+  R call(Args... args) override
+  {
+    return std::invoke(*f, std::forward<Args>(args)...);
+  }
+
+  F* f;
+};
+
+}
+
+// Move-only type-erased callable on top of impl. Callables are stored by
+// value, inline if they fit Capacity (the storage also holds a vptr) and on
+// the heap otherwise, or by reference when passed as std::ref(f) or
+// ddw::impl_by_reference(f). ddw::impl_by_small_value(f) enforces inline
+// storage at compile time.
+template<typename Signature, std::size_t Capacity = 32, std::size_t Alignment = sizeof(void*)>
+class fn;
+
+template<typename R, typename... Args, std::size_t Capacity, std::size_t Alignment>
+class fn<R(Args...), Capacity, Alignment>
+{
+public:
+  static const std::size_t capacity = Capacity;
+  static const std::size_t alignment = Alignment;
+  using this_type = fn<R(Args...), capacity, alignment>;
+
+  fn() = default;
+
+  template<typename F, typename = std::enable_if_t<
+      not std::is_same_v<std::decay_t<F>, this_type> and std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+  fn(F&& f)
+  {
+    d.template emplace<value_type<F>>(std::forward<F>(f));
+  }
+
+  template<typename F>
+  fn(std::reference_wrapper<F> f)
+  {
+    d.template emplace_small<reference_type<F>>(f.get());
+  }
+
+  template<typename F>
+  fn(detail::impl_forced_value<F>&& f)
+  {
+    d.template emplace<value_type<F>>(std::forward<F>(f.v));
+  }
+
+  template<typename F>
+  fn(detail::impl_forced_small_value<F>&& f)
+  {
+    d.template emplace_small<value_type<F>>(std::forward<F>(f.v));
+  }
+
+  template<typename F, typename = std::enable_if_t<std::is_lvalue_reference_v<F>>>
+  fn(detail::impl_forced_reference<F>&& f)
+  {
+    d.template emplace_small<reference_type<std::remove_reference_t<F>>>(f.v);
+  }
+
+  fn(this_type&& other) : d(std::move(other.d)) {}
+  fn(const this_type&) = delete;
+
+  this_type& operator=(this_type&& other)
+  {
+    d = std::move(other.d);
+    return *this;
+  }
+
+  R operator()(Args... args)
+  {
+    return d->call(std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const
+  {
+    return d.has_impl();
+  }
+
+private:
+  template<typename F>
+  using value_type = detail::fn_value<std::decay_t<F>, R, Args...>;
+
+  template<typename F>
+  using reference_type = detail::fn_reference<F, R, Args...>;
+
+  impl<detail::fn_callable<R, Args...>, capacity, alignment> d;
+};
+
+}
+
+#endif
@@ -2,16 +2,40 @@
 #define IMPL_WRAPPER_HPP_
 
 #include <type_traits>
+#include <tuple>
 #include <utility>
 #include <memory>
 #include <variant>
+#include <cstring>
+
+#if defined(__GNUC__)
+#define DDW_IMPL_COLD __attribute__((noinline, cold))
+#else
+#define DDW_IMPL_COLD
+#endif
 
 namespace ddw
 {
 
+// Opt-in: specialize as std::true_type for implementation types that may be
+// moved by copying their bytes, vptr included. Such a type must not point into
+// itself, and its destructor, which still runs on the source bytes after the
+// copy, must not release anything the copy goes on using. All opted-in types
+// of the same size share a single move thunk instead of instantiating one
+// each. Implementation types derive from a polymorphic interface, so none of
+// them is trivially move-constructible and nothing is folded by default.
+template<typename U>
+struct impl_trivially_movable : std::false_type {};
+
 namespace detail
 {
 
+template<std::size_t Size>
+void impl_move_bytes(void* dst, void* src)
+{
+  std::memcpy(dst, src, Size);
+}
+
 template<typename T>
 struct impl_raw_ptr {
   using interface_type = T;
@@ -26,7 +50,7 @@ struct impl_raw_ptr {
     return ptr;
   }
 
-  impl_raw_ptr(interface_type* p = nullptr) : ptr(p) {}
+  constexpr impl_raw_ptr(interface_type* p = nullptr) noexcept : ptr(p) {}
 
 private:
   interface_type* ptr;
@@ -46,9 +70,17 @@ struct impl_small_value
   {
     using impl_type = U;
 
-    static void move(value_storage* dst, value_storage* src)
+    static void move(void* dst, void* src)
+    {
+      new (dst) impl_type(reinterpret_cast<impl_type&&>(*static_cast<value_storage*>(src)));
+    }
+
+    static constexpr void (*mover())(void*, void*)
     {
-      new (dst) impl_type(reinterpret_cast<impl_type&&>(*src));
+      if constexpr (impl_trivially_movable<impl_type>::value)
+        return impl_move_bytes<sizeof(impl_type)>;
+      else
+        return move;
     }
   };
 
@@ -69,7 +101,7 @@ struct impl_small_value
   impl_small_value(U&& v)
   {
     using impl_type = std::remove_const_t<std::remove_reference_t<U>>;
-    move = cbs<impl_type>::move;
+    move = cbs<impl_type>::mover();
     new (&value) impl_type(std::forward<U>(v));
   }
 
@@ -77,7 +109,7 @@ struct impl_small_value
   impl_small_value(U*, Args&&... args)
   {
     using impl_type = U;
-    move = cbs<impl_type>::move;
+    move = cbs<impl_type>::mover();
     new (&value) impl_type(std::forward<Args>(args)...);
   }
 
@@ -94,7 +126,7 @@ struct impl_small_value
   }
 
 private:
-  void (*move)(value_storage* dst, value_storage* src);
+  void (*move)(void* dst, void* src);
   value_storage value;
 
   template<typename U, std::size_t C, std::size_t A>
@@ -142,6 +174,18 @@ public:
 
   impl() = default;
 
+  // Storing a reference is a constant expression, so globals that refer to a
+  // singleton are constant-initialized and need no code at startup.
+  template<typename U, typename = std::enable_if_t<std::is_base_of_v<T, U>>>
+  constexpr impl(U& v) : _d(std::in_place_type<raw_type>, &v) {}
+
+  // Only for lvalues: impl_by_reference() of a temporary is rejected below.
+  template<typename U, typename = std::enable_if_t<std::is_lvalue_reference_v<U>>>
+  constexpr impl(detail::impl_forced_reference<U>&& v) : _d(std::in_place_type<raw_type>, &v.v)
+  {
+    static_assert(std::is_base_of_v<T, std::remove_reference_t<U>>, "T is not a base of U");
+  }
+
   template<typename U>
   impl(U&& v)
   {
@@ -180,6 +224,11 @@ public:
     return has_impl();
   }
 
+  void reset()
+  {
+    _d.template emplace<raw_type>();
+  }
+
   template<typename U>
   void reset(U&& v)
   {
@@ -215,7 +264,7 @@ public:
   }
 
   template<typename U>
-  void reset_big_value(U&& v)
+  DDW_IMPL_COLD void reset_big_value(U&& v)
   {
     using impl_type = std::remove_const_t<std::remove_reference_t<U>>;
     static_assert(std::is_move_constructible_v<U>, "U is not move-constructible");
@@ -243,9 +292,16 @@ public:
     static_assert(std::is_base_of_v<T, U>, "T is not a base of U");
     static_assert(C == capacity, "cannot convert between different capacities");
     static_assert(A == alignment, "cannot convert between different alignments");
-    std::visit([this](auto &d) {
-      auto_selector<std::remove_reference_t<decltype(d)>>::reset(this, std::move(d));
-    }, v._d);
+    if (auto d = std::get_if<typename impl<U, C, A>::small_type>(&v._d))
+      auto_selector<std::remove_reference_t<decltype(*d)>>::reset(this, std::move(*d));
+    else if (auto d = std::get_if<typename impl<U, C, A>::raw_type>(&v._d))
+      auto_selector<std::remove_reference_t<decltype(*d)>>::reset(this, std::move(*d));
+    else if (auto d = std::get_if<typename impl<U, C, A>::unique_type>(&v._d))
+      auto_selector<std::remove_reference_t<decltype(*d)>>::reset(this, std::move(*d));
+    else if (auto d = std::get_if<typename impl<U, C, A>::shared_type>(&v._d))
+      auto_selector<std::remove_reference_t<decltype(*d)>>::reset(this, std::move(*d));
+    else
+      reset();
   }
 
   template<typename U, typename... Args>
@@ -270,20 +326,27 @@ public:
   }
 
   template<typename U, typename... Args>
-  void emplace_big(Args&&... args)
+  DDW_IMPL_COLD void emplace_big(Args&&... args)
   {
     static_assert(std::is_base_of_v<T, U>, "T is not a base of U");
     _d.template emplace<unique_type>(std::make_unique<U>(std::forward<Args>(args)...));
   }
 
+  // Dispatches on the variant index through std::get_if rather than
+  // std::visit, so dereferencing has no bad_variant_access path and builds
+  // with -fno-exceptions. A valueless variant yields nullptr.
   interface_type* get()
   {
-    return std::visit([](auto& d) { return d.get(); }, _d);
+    if (auto d = std::get_if<small_type>(&_d)) return d->get();
+    if (auto d = std::get_if<raw_type>(&_d)) return d->get();
+    if (auto d = std::get_if<unique_type>(&_d)) return d->get();
+    if (auto d = std::get_if<shared_type>(&_d)) return d->get();
+    return nullptr;
   }
 
   const interface_type* get() const
   {
-    return std::visit([](const auto& d) -> const interface_type* { return d.get(); }, _d);
+    return const_cast<this_type*>(this)->get();
   }
 
   bool has_impl() const
@@ -438,7 +501,7 @@ auto impl_by_small_value(U&& v)
 }
 
 template<typename U>
-auto impl_by_reference(U&& v)
+constexpr auto impl_by_reference(U&& v)
 {
   return detail::impl_forced_reference<U>{std::forward<U>(v)};
 }
@@ -446,7 +509,7 @@ auto impl_by_reference(U&& v)
 template<typename U, typename... Args>
 auto impl_emplace(Args&&... args)
 {
-  return detail::impl_emplacement<U, Args...>(std::forward<Args...>(args)...);
+  return detail::impl_emplacement<U, Args...>(std::forward<Args>(args)...);
 }
 
 }
@@ -0,0 +1,186 @@
+#ifndef IMPL_MAP_HPP_
+#define IMPL_MAP_HPP_
+
+#include "impl.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace ddw
+{
+
+// Open-addressing hash map from Key to impl<T, Capacity, Alignment>.
+// Keys and implementations are stored inline in the table, so a lookup of a
+// small implementation touches a single slot. Collisions are resolved by
+// linear probing and erase() shifts displaced entries back, so there are no
+// tombstones. Key must be default-constructible.
+template<typename Key, typename T, std::size_t Capacity = 32, std::size_t Alignment = sizeof(void*),
+    typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class impl_map
+{
+public:
+  using key_type = Key;
+  using interface_type = T;
+  using mapped_type = impl<T, Capacity, Alignment>;
+
+  explicit impl_map(std::size_t expected = 8)
+  {
+    allocate(expected * 4 / 3 + 1);
+  }
+
+  impl_map(const impl_map&) = delete;
+  impl_map& operator=(const impl_map&) = delete;
+
+  template<typename U>
+  mapped_type& insert_or_assign(const key_type& key, U&& v)
+  {
+    slot& s = find_or_insert(key);
+    s.value = std::forward<U>(v);
+    return s.value;
+  }
+
+  template<typename U, typename... Args>
+  mapped_type& emplace(const key_type& key, Args&&... args)
+  {
+    slot& s = find_or_insert(key);
+    s.value.template emplace<U>(std::forward<Args>(args)...);
+    return s.value;
+  }
+
+  interface_type* find(const key_type& key)
+  {
+    slot* s = lookup(key);
+    return s ? s->value.get() : nullptr;
+  }
+
+  const interface_type* find(const key_type& key) const
+  {
+    const slot* s = const_cast<impl_map*>(this)->lookup(key);
+    return s ? s->value.get() : nullptr;
+  }
+
+  bool contains(const key_type& key) const
+  {
+    return const_cast<impl_map*>(this)->lookup(key) != nullptr;
+  }
+
+  bool erase(const key_type& key)
+  {
+    slot* s = lookup(key);
+    if (not s) return false;
+    std::size_t hole = s - slots.get();
+    for (std::size_t j = (hole + 1) & mask; slots[j].used; j = (j + 1) & mask)
+    {
+      std::size_t home = index(slots[j].key);
+      if (((j - home) & mask) >= ((j - hole) & mask))
+      {
+        slots[hole].key = std::move(slots[j].key);
+        slots[hole].value = std::move(slots[j].value);
+        hole = j;
+      }
+    }
+    clear_slot(slots[hole]);
+    count--;
+    return true;
+  }
+
+  void clear()
+  {
+    for (std::size_t i = 0; i <= mask; i++)
+      if (slots[i].used) clear_slot(slots[i]);
+    count = 0;
+  }
+
+  std::size_t size() const
+  {
+    return count;
+  }
+
+  bool empty() const
+  {
+    return count == 0;
+  }
+
+private:
+  struct slot
+  {
+    bool used = false;
+    key_type key;
+    mapped_type value;
+  };
+
+  std::size_t index(const key_type& key) const
+  {
+    // Fibonacci hashing spreads poor hashes such as the identity on integers.
+    return (std::uint64_t(Hash()(key)) * 0x9e3779b97f4a7c15ULL) >> shift;
+  }
+
+  slot* lookup(const key_type& key)
+  {
+    for (std::size_t i = index(key);; i = (i + 1) & mask)
+    {
+      slot& s = slots[i];
+      if (not s.used) return nullptr;
+      if (KeyEqual()(s.key, key)) return &s;
+    }
+  }
+
+  slot& find_or_insert(const key_type& key)
+  {
+    if ((count + 1) * 4 > (mask + 1) * 3)
+      grow();
+    std::size_t i = index(key);
+    for (; slots[i].used; i = (i + 1) & mask)
+      if (KeyEqual()(slots[i].key, key)) return slots[i];
+    slots[i].used = true;
+    slots[i].key = key;
+    count++;
+    return slots[i];
+  }
+
+  static void clear_slot(slot& s)
+  {
+    s.used = false;
+    s.key = key_type();
+    s.value.reset();
+  }
+
+  void allocate(std::size_t n)
+  {
+    std::size_t size = 8;
+    shift = 61;
+    while (size < n)
+    {
+      size *= 2;
+      shift--;
+    }
+    slots = std::make_unique<slot[]>(size);
+    mask = size - 1;
+  }
+
+  DDW_IMPL_COLD void grow()
+  {
+    std::unique_ptr<slot[]> old = std::move(slots);
+    std::size_t old_size = mask + 1;
+    allocate(old_size * 2);
+    for (std::size_t i = 0; i < old_size; i++)
+    {
+      if (not old[i].used) continue;
+      std::size_t j = index(old[i].key);
+      while (slots[j].used)
+        j = (j + 1) & mask;
+      slots[j].used = true;
+      slots[j].key = std::move(old[i].key);
+      slots[j].value = std::move(old[i].value);
+    }
+  }
+
+  std::unique_ptr<slot[]> slots;
+  std::size_t mask = 0;
+  std::size_t count = 0;
+  unsigned shift = 0;
+};
+
+}
+
+#endif
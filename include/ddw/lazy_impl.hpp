@@ -0,0 +1,181 @@
+#ifndef IMPL_LAZY_IMPL_HPP_
+#define IMPL_LAZY_IMPL_HPP_
+
+#include "impl.hpp"
+#include <atomic>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ddw
+{
+
+namespace detail
+{
+
+template<typename U, typename... Args>
+struct impl_lazy_args
+{
+  std::tuple<Args...> args;
+};
+
+template<typename Impl>
+struct lazy_factory_base
+{
+  virtual ~lazy_factory_base() {}
+  virtual void build(Impl& out) = 0;
+};
+
+template<typename Impl, typename U, typename... Args>
+struct lazy_factory : lazy_factory_base<Impl>
+{
+  lazy_factory(std::tuple<Args...>&& args) : args(std::move(args)) {}
+
+  void build(Impl& out) override
+  {
+    std::apply([&out](Args&... a) { out.template emplace<U>(std::move(a)...); }, args);
+  }
+
+  std::tuple<Args...> args;
+};
+
+}
+
+// Holder of a T implementation that is constructed on first dereference.
+// ddw::impl_lazy<U>(args...) stores the arguments in an inline factory of at
+// most FactoryCapacity bytes (by default Capacity); the first get() from any
+// thread constructs the U into impl<T, Capacity, Alignment> storage, while
+// concurrent callers wait. If the constructor throws, nothing is built and a
+// later get() constructs again, from arguments that the failed attempt may
+// have moved from.
+// Afterwards, get() is a single acquire load of the published pointer.
+// Anything else that impl accepts is stored eagerly. Moving a lazy_impl while
+// another thread dereferences it is not allowed.
+template<typename T, std::size_t Capacity = 32, std::size_t Alignment = sizeof(void*), std::size_t FactoryCapacity = Capacity>
+class lazy_impl
+{
+public:
+  using interface_type = T;
+  using value_type = impl<T, Capacity, Alignment>;
+  using this_type = lazy_impl<T, Capacity, Alignment, FactoryCapacity>;
+
+  lazy_impl() = default;
+
+  template<typename U, typename... Args>
+  lazy_impl(detail::impl_lazy_args<U, Args...>&& lazy)
+  {
+    factory.template emplace_small<detail::lazy_factory<value_type, U, Args...>>(std::move(lazy.args));
+  }
+
+  template<typename U, typename = std::enable_if_t<not std::is_same_v<std::decay_t<U>, this_type>>>
+  lazy_impl(U&& v) : value(std::forward<U>(v))
+  {
+    sync_state();
+  }
+
+  lazy_impl(this_type&& other) : value(std::move(other.value)), factory(std::move(other.factory))
+  {
+    sync_state();
+    other.sync_state();
+  }
+
+  this_type& operator=(this_type&& other)
+  {
+    value = std::move(other.value);
+    factory = std::move(other.factory);
+    sync_state();
+    other.sync_state();
+    return *this;
+  }
+
+  interface_type* get()
+  {
+    interface_type* p = ptr.load(std::memory_order_acquire);
+    if (__builtin_expect(p != nullptr, 1)) return p;
+    return build();
+  }
+
+  interface_type& operator*()
+  {
+    return *get();
+  }
+
+  interface_type* operator->()
+  {
+    return get();
+  }
+
+  // True if a value or a factory is held; does not construct anything.
+  bool has_impl() const
+  {
+    return ptr.load(std::memory_order_acquire) or factory.has_impl();
+  }
+
+  explicit operator bool() const
+  {
+    return has_impl();
+  }
+
+  bool built() const
+  {
+    return ptr.load(std::memory_order_acquire) != nullptr;
+  }
+
+private:
+  // Derives ptr and state from what value holds, after it changed hands.
+  void sync_state()
+  {
+    interface_type* p = value.get();
+    ptr.store(p, std::memory_order_relaxed);
+    state.store(p ? 2 : 0, std::memory_order_relaxed);
+  }
+
+  // Like std::call_once: if the constructor throws, the exception propagates
+  // to this caller and the next one (or a waiting one) tries again.
+  DDW_IMPL_COLD interface_type* build()
+  {
+    for (;;)
+    {
+      int expected = 0;
+      if (state.compare_exchange_strong(expected, 1, std::memory_order_acquire))
+      {
+        try
+        {
+          if (factory)
+          {
+            factory->build(value);
+            factory.reset();
+          }
+        }
+        catch (...)
+        {
+          state.store(0, std::memory_order_release);
+          throw;
+        }
+        interface_type* p = value.get();
+        ptr.store(p, std::memory_order_release);
+        state.store(2, std::memory_order_release);
+        return p;
+      }
+      if (expected == 2)
+        return ptr.load(std::memory_order_acquire);
+      std::this_thread::yield();
+    }
+  }
+
+  std::atomic<interface_type*> ptr{nullptr};
+  std::atomic<int> state{0};
+  value_type value;
+  impl<detail::lazy_factory_base<value_type>, FactoryCapacity> factory;
+};
+
+template<typename U, typename... Args>
+auto impl_lazy(Args&&... args)
+{
+  return detail::impl_lazy_args<U, std::decay_t<Args>...>{std::tuple<std::decay_t<Args>...>(std::forward<Args>(args)...)};
+}
+
+}
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef IMPL_PARALLEL_HPP_
+#define IMPL_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__GXX_RTTI) || defined(_CPPRTTI)
+#include <typeinfo>
+#endif
+
+namespace ddw
+{
+
+struct parallel_options
+{
+  // Number of threads to use, including the caller; 0 uses all of them.
+  std::size_t threads = 0;
+  // Elements per chunk; 0 picks a size of whole cache lines that gives every
+  // thread several chunks.
+  std::size_t chunk = 0;
+  // Visit the elements of each chunk ordered by the dynamic type of what they
+  // point to, so that consecutive virtual calls go to the same target.
+  bool group_by_type = false;
+};
+
+namespace detail
+{
+
+// Process-wide pool of hardware_concurrency() - 1 workers that help the
+// calling thread through the chunks of one job at a time. Jobs started from
+// inside a job run on the calling thread only.
+class parallel_pool
+{
+public:
+  static parallel_pool& instance()
+  {
+    static parallel_pool p(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return p;
+  }
+
+  std::size_t size() const
+  {
+    return workers.size() + 1;
+  }
+
+  // Calls body(i) for every chunk i in [0, chunks) on at most `threads` threads.
+  // If body throws, chunks not started yet are skipped, and the first
+  // exception is rethrown once no thread works on the job anymore.
+  template<typename F>
+  void run(std::size_t chunks, std::size_t threads, F& body)
+  {
+    if (in_job() or threads <= 1 or workers.empty())
+    {
+      for (std::size_t i = 0; i < chunks; i++)
+        body(i);
+      return;
+    }
+    std::lock_guard<std::mutex> serial(run_mutex);
+    job j{&invoke<F>, &body, chunks, threads - 1};
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current = &j;
+      generation++;
+    }
+    wake.notify_all();
+    work(j);
+    std::unique_lock<std::mutex> lock(mutex);
+    current = nullptr;
+    done.wait(lock, [&]() { return j.active == 0; });
+    if (j.error)
+      std::rethrow_exception(j.error);
+  }
+
+private:
+  struct job
+  {
+    void (*call)(void* body, std::size_t i);
+    void* body;
+    std::size_t chunks;
+    std::size_t helpers;
+    std::atomic<std::size_t> next{0};
+    std::size_t active = 0;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error{};
+  };
+
+  template<typename F>
+  static void invoke(void* body, std::size_t i)
+  {
+    (*static_cast<F*>(body))(i);
+  }
+
+  static bool& in_job()
+  {
+    thread_local bool flag = false;
+    return flag;
+  }
+
+  static void work(job& j)
+  {
+    in_job() = true;
+    try
+    {
+      for (std::size_t i; (i = j.next.fetch_add(1, std::memory_order_relaxed)) < j.chunks; )
+        j.call(j.body, i);
+    }
+    catch (...)
+    {
+      j.next.store(j.chunks, std::memory_order_relaxed);
+      if (not j.failed.exchange(true))
+        j.error = std::current_exception();
+    }
+    in_job() = false;
+  }
+
+  explicit parallel_pool(std::size_t n)
+  {
+    for (std::size_t i = 0; i < n; i++)
+    {
+      workers.emplace_back([this]()
+      {
+        std::uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+          wake.wait(lock, [&]() { return stopping or generation != seen; });
+          if (stopping) return;
+          seen = generation;
+          job* j = current;
+          if (not j or j->helpers == 0) continue;
+          j->helpers--;
+          j->active++;
+          lock.unlock();
+          work(*j);
+          lock.lock();
+          if (--j->active == 0) done.notify_all();
+        }
+      });
+    }
+  }
+
+  ~parallel_pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers)
+      w.join();
+  }
+
+  std::mutex run_mutex;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  job* current = nullptr;
+  std::uint64_t generation = 0;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
+
+template<typename E, typename = void>
+struct parallel_pointee
+{
+  using type = void;
+};
+
+template<typename E>
+struct parallel_pointee<E, std::void_t<decltype(std::declval<const E&>().get())>>
+{
+  using type = std::remove_pointer_t<decltype(std::declval<const E&>().get())>;
+};
+
+// Identity of the dynamic type of the object an element (an impl or a smart
+// pointer) refers to, or nullptr if it cannot be told.
+template<typename E>
+const void* parallel_type_key(const E& e)
+{
+#if defined(__GXX_RTTI) || defined(_CPPRTTI)
+  if constexpr (std::is_polymorphic_v<typename parallel_pointee<E>::type>)
+  {
+    auto p = e.get();
+    return p ? &typeid(*p) : nullptr;
+  }
+#endif
+  (void)e;
+  return nullptr;
+}
+
+template<typename It>
+std::size_t parallel_chunk_size(std::size_t n, std::size_t threads, const parallel_options& o)
+{
+  if (o.chunk) return o.chunk;
+  using value_type = typename std::iterator_traits<It>::value_type;
+  std::size_t line = 64 / std::gcd<std::size_t>(64, sizeof(value_type));
+  std::size_t chunk = std::max<std::size_t>(n / (threads * 8), 1);
+  return (chunk + line - 1) / line * line;
+}
+
+// Calls f for every element of [first, last). If requested, elements are
+// visited in blocks that stay in L1, each one reordered by dynamic type with
+// a counting sort that has no data-dependent branches, so that neither the
+// sort nor the calls mispredict. Blocks with more than max_groups types are
+// visited as they are.
+template<typename It, typename F>
+void parallel_visit(It first, It last, bool group_by_type, F& f)
+{
+  if (not group_by_type)
+  {
+    for (; first != last; ++first)
+      f(*first);
+    return;
+  }
+  const std::size_t block = 256;
+  const std::size_t max_groups = 8;
+  const void* groups[max_groups];
+  std::uint8_t group_of[block];
+  std::uint16_t order[block];
+  while (first != last)
+  {
+    std::size_t n = std::min<std::size_t>(block, last - first);
+    std::size_t group_count = 0;
+    for (std::size_t i = 0; i < n and group_count <= max_groups; i++)
+    {
+      const void* key = parallel_type_key(first[i]);
+      std::size_t g = 0;
+      bool found = false;
+      for (std::size_t j = 0; j < group_count; j++)
+      {
+        g += (key == groups[j]) * j;
+        found |= key == groups[j];
+      }
+      if (not found)
+      {
+        if (group_count < max_groups)
+          groups[group_count] = key;
+        g = group_count++;
+      }
+      group_of[i] = std::uint8_t(g);
+    }
+    if (group_count > max_groups)
+    {
+      for (std::size_t i = 0; i < n; i++)
+        f(first[i]);
+    }
+    else
+    {
+      std::size_t offset[max_groups + 1] = {};
+      for (std::size_t i = 0; i < n; i++)
+        offset[group_of[i] + 1]++;
+      for (std::size_t g = 1; g <= group_count; g++)
+        offset[g] += offset[g - 1];
+      for (std::size_t i = 0; i < n; i++)
+        order[offset[group_of[i]]++] = std::uint16_t(i);
+      for (std::size_t k = 0; k < n; k++)
+        f(first[order[k]]);
+    }
+    first += n;
+  }
+}
+
+}
+
+// Calls f(element) for every element of the random-access range
+// [first, last), split into chunks that run in parallel on the built-in
+// thread pool. If f throws, the remaining chunks are skipped and the first
+// exception is rethrown once all threads are done.
+template<typename It, typename F>
+void parallel_for_each(It first, It last, F f, parallel_options o = {})
+{
+  auto& pool = detail::parallel_pool::instance();
+  std::size_t n = last - first;
+  std::size_t threads = o.threads ? std::min(o.threads, pool.size()) : pool.size();
+  std::size_t chunk = detail::parallel_chunk_size<It>(n, threads, o);
+  std::size_t chunks = (n + chunk - 1) / chunk;
+  auto body = [&](std::size_t i)
+  {
+    It b = first + i * chunk;
+    It e = first + std::min(n, (i + 1) * chunk);
+    detail::parallel_visit(b, e, o.group_by_type, f);
+  };
+  pool.run(chunks, threads, body);
+}
+
+// Returns init combined through reduce with transform(element) of every
+// element of [first, last). Chunks are reduced in parallel, then their
+// results are combined in order, so reduce needs to be associative, and only
+// commutative as well with group_by_type. R must be default-constructible.
+template<typename It, typename R, typename Reduce, typename Transform>
+R parallel_transform_reduce(It first, It last, R init, Reduce reduce, Transform transform, parallel_options o = {})
+{
+  auto& pool = detail::parallel_pool::instance();
+  std::size_t n = last - first;
+  std::size_t threads = o.threads ? std::min(o.threads, pool.size()) : pool.size();
+  std::size_t chunk = detail::parallel_chunk_size<It>(n, threads, o);
+  std::size_t chunks = (n + chunk - 1) / chunk;
+  std::vector<R> partial(chunks);
+  auto body = [&](std::size_t i)
+  {
+    It b = first + i * chunk;
+    It e = first + std::min(n, (i + 1) * chunk);
+    bool first_element = true;
+    R acc{};
+    auto step = [&](auto& v)
+    {
+      if (first_element)
+        acc = transform(v);
+      else
+        acc = reduce(std::move(acc), transform(v));
+      first_element = false;
+    };
+    detail::parallel_visit(b, e, o.group_by_type, step);
+    partial[i] = std::move(acc);
+  };
+  pool.run(chunks, threads, body);
+  for (auto& p : partial)
+    init = reduce(std::move(init), std::move(p));
+  return init;
+}
+
+}
+
+#endif
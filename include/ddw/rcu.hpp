@@ -0,0 +1,154 @@
+#ifndef IMPL_RCU_HPP_
+#define IMPL_RCU_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ddw
+{
+
+namespace detail
+{
+
+struct alignas(64) rcu_slot
+{
+  std::atomic<std::uint64_t> epoch{0};
+  std::atomic<bool> owned{true};
+  unsigned depth = 0;
+  rcu_slot* next = nullptr;
+};
+
+// Epoch-based grace periods shared by atomic_impl and signal instances.
+// Every reader thread owns a slot in which it announces the epoch it entered
+// a read-side section in, or 0 when it is quiescent. Readers only use plain
+// loads and stores: on Linux the store-load ordering that they would need is
+// provided by the writer through membarrier(), elsewhere they fall back to a
+// fence.
+class rcu_domain
+{
+public:
+  static rcu_domain& instance()
+  {
+    static rcu_domain d;
+    return d;
+  }
+
+  rcu_slot& local_slot()
+  {
+    thread_local slot_owner owner(*this);
+    return *owner.slot;
+  }
+
+  void enter(rcu_slot& s)
+  {
+    if (s.depth++ != 0) return;
+    s.epoch.store(epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    if (expedited)
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    else
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void exit(rcu_slot& s)
+  {
+    if (--s.depth != 0) return;
+    s.epoch.store(0, std::memory_order_release);
+  }
+
+  bool in_read_section()
+  {
+    return local_slot().depth != 0;
+  }
+
+  // Waits until every reader that might still see data unpublished before
+  // this call has left its read-side section. Must not be called from inside
+  // a read-side section.
+  void synchronize()
+  {
+    std::uint64_t e = epoch.fetch_add(1) + 1;
+    heavy_barrier();
+    for (rcu_slot* s = head.load(std::memory_order_acquire); s; s = s->next)
+    {
+      for (;;)
+      {
+        std::uint64_t v = s->epoch.load(std::memory_order_acquire);
+        if (v == 0 or v >= e) break;
+        std::this_thread::yield();
+      }
+    }
+  }
+
+private:
+  struct slot_owner
+  {
+    rcu_slot* slot;
+
+    slot_owner(rcu_domain& d) : slot(d.acquire_slot()) {}
+    ~slot_owner() { slot->owned.store(false, std::memory_order_release); }
+  };
+
+  rcu_domain()
+  {
+#if defined(__linux__)
+    expedited = syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+#endif
+  }
+
+  rcu_slot* acquire_slot()
+  {
+    for (rcu_slot* s = head.load(std::memory_order_acquire); s; s = s->next)
+    {
+      bool expected = false;
+      if (s->owned.compare_exchange_strong(expected, true))
+        return s;
+    }
+    rcu_slot* s = new rcu_slot;
+    s->next = head.load(std::memory_order_relaxed);
+    while (not head.compare_exchange_weak(s->next, s))
+      ;
+    return s;
+  }
+
+  void heavy_barrier()
+  {
+#if defined(__linux__)
+    if (expedited and syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0) == 0)
+      return;
+#endif
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  std::atomic<std::uint64_t> epoch{1};
+  std::atomic<rcu_slot*> head{nullptr};
+  bool expedited = false;
+};
+
+struct rcu_read_lock
+{
+  rcu_slot& slot;
+
+  rcu_read_lock() : slot(rcu_domain::instance().local_slot())
+  {
+    rcu_domain::instance().enter(slot);
+  }
+
+  rcu_read_lock(const rcu_read_lock&) = delete;
+
+  ~rcu_read_lock()
+  {
+    rcu_domain::instance().exit(slot);
+  }
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef IMPL_SIGNAL_HPP_
+#define IMPL_SIGNAL_HPP_
+
+#include "impl.hpp"
+#include "rcu.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ddw
+{
+
+// List of listeners implementing T, each held in an impl<T, C, A>, so they
+// can be connected by value or through ddw::impl_by_reference(). emit() walks
+// an immutable snapshot of the listeners inside a read-side section, without
+// locking or copying. connect() and disconnect() publish a new snapshot under
+// a mutex, then, after releasing it, reclaim the old one once all emits that
+// could still see it are done; when they are called from within a listener,
+// reclamation is deferred to the next connect() or disconnect() outside of an
+// emit.
+template<typename T, std::size_t Capacity = 32, std::size_t Alignment = sizeof(void*)>
+class signal
+{
+public:
+  using interface_type = T;
+  using value_type = impl<T, Capacity, Alignment>;
+  using connection = std::uint64_t;
+
+  signal() = default;
+  signal(const signal&) = delete;
+
+  ~signal()
+  {
+    if (snapshot* s = current.load(std::memory_order_relaxed))
+    {
+      for (listener* l : s->listeners)
+        delete l;
+      delete s;
+    }
+    reclaim(retired);
+  }
+
+  template<typename U>
+  connection connect(U&& v)
+  {
+    listener* l = new listener{0, std::forward<U>(v), nullptr};
+    l->target = l->value.get();
+    retired_list r;
+    connection id;
+    {
+      std::lock_guard<std::mutex> lock(writer);
+      id = l->id = ++last_id;
+      snapshot* old = current.load(std::memory_order_relaxed);
+      snapshot* s = new snapshot;
+      if (old) *s = *old;
+      s->listeners.push_back(l);
+      s->targets.push_back(l->target);
+      r = publish(s, nullptr);
+    }
+    synchronize_and_reclaim(r);
+    return id;
+  }
+
+  bool disconnect(connection c)
+  {
+    retired_list r;
+    {
+      std::lock_guard<std::mutex> lock(writer);
+      snapshot* old = current.load(std::memory_order_relaxed);
+      if (not old) return false;
+      snapshot* s = new snapshot;
+      listener* removed = nullptr;
+      for (listener* l : old->listeners)
+      {
+        if (l->id == c)
+          removed = l;
+        else
+        {
+          s->listeners.push_back(l);
+          s->targets.push_back(l->target);
+        }
+      }
+      if (not removed)
+      {
+        delete s;
+        return false;
+      }
+      r = publish(s, removed);
+    }
+    synchronize_and_reclaim(r);
+    return true;
+  }
+
+  // Calls f(T&) for every listener connected when the emit started.
+  template<typename F>
+  void emit(F&& f) const
+  {
+    detail::rcu_read_lock lock;
+    const snapshot* s = current.load(std::memory_order_acquire);
+    if (not s) return;
+    for (interface_type* t : s->targets)
+      f(*t);
+  }
+
+  std::size_t size() const
+  {
+    detail::rcu_read_lock lock;
+    const snapshot* s = current.load(std::memory_order_acquire);
+    return s ? s->listeners.size() : 0;
+  }
+
+private:
+  struct listener
+  {
+    connection id;
+    value_type value;
+    interface_type* target;
+  };
+
+  struct snapshot
+  {
+    std::vector<listener*> listeners;
+    std::vector<interface_type*> targets;
+  };
+
+  struct retired_list
+  {
+    std::vector<snapshot*> snapshots;
+    std::vector<listener*> listeners;
+  };
+
+  // Called with writer held. Returns what the caller may reclaim after
+  // releasing it, which is nothing while inside an emit.
+  retired_list publish(snapshot* s, listener* removed)
+  {
+    retired.snapshots.push_back(current.exchange(s, std::memory_order_acq_rel));
+    if (removed) retired.listeners.push_back(removed);
+    retired_list r;
+    if (not detail::rcu_domain::instance().in_read_section())
+      std::swap(r, retired);
+    return r;
+  }
+
+  // Called without writer, which readers that connect or disconnect from a
+  // listener may be waiting for while synchronize() waits for them.
+  static void synchronize_and_reclaim(retired_list& r)
+  {
+    if (r.snapshots.empty()) return;
+    detail::rcu_domain::instance().synchronize();
+    reclaim(r);
+  }
+
+  static void reclaim(retired_list& r)
+  {
+    for (snapshot* s : r.snapshots)
+      delete s;
+    for (listener* l : r.listeners)
+      delete l;
+    r.snapshots.clear();
+    r.listeners.clear();
+  }
+
+  std::atomic<snapshot*> current{nullptr};
+  std::mutex writer;
+  connection last_id = 0;
+  retired_list retired;
+};
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "ddw/impl.hpp"
+#include "actor.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual void handle(long& state) = 0;
+
+  // Counts messages that did not fit their mailbox slot.
+  static std::atomic<long> allocations;
+  static void* operator new(std::size_t size)
+  {
+    allocations++;
+    return ::operator new(size);
+  }
+  static void* operator new(std::size_t, void* p)
+  {
+    return p;
+  }
+  static void operator delete(void* p)
+  {
+    ::operator delete(p);
+  }
+};
+std::atomic<long> msg::allocations{0};
+
+struct add_msg : msg
+{
+  long n;
+  add_msg(long n) : n(n) {}
+  void handle(long& state) override { state += n; }
+};
+
+using system_type = actor_system<msg>;
+
+// Sends count messages from each of the producers to actors in round-robin
+// order and returns the state of every actor.
+std::vector<long> run_actors(std::size_t actors, std::size_t workers, std::size_t producers, long count)
+{
+  std::vector<long> state(actors);
+  system_type sys(actors, workers);
+  sys.start([&](std::size_t a, system_type::value_type& m) { m->handle(state[a]); });
+  std::vector<std::thread> threads;
+  for (std::size_t p = 0; p < producers; p++)
+  {
+    threads.emplace_back([&, p]()
+    {
+      for (long i = 0; i < count; i++)
+      {
+        std::size_t a = (p + i * producers) % actors;
+        while (not sys.send<add_msg>(a, 1))
+          std::this_thread::yield();
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+  sys.stop();
+  return state;
+}
+
+}
+
+TEST(actor_system, handles_every_message_once)
+{
+  msg::allocations = 0;
+  auto state = run_actors(1000, 3, 2, 100000);
+  long sum = 0;
+  for (auto s : state)
+    sum += s;
+  ASSERT_EQ(200000, sum);
+  ASSERT_EQ(200, *std::max_element(state.begin(), state.end()));
+  ASSERT_EQ(0, msg::allocations);
+}
+
+TEST(actor_system, single_actor_many_senders)
+{
+  auto state = run_actors(1, 2, 4, 50000);
+  ASSERT_EQ(200000, state[0]);
+}
+
+TEST(actor_system, idle_workers_wake_up)
+{
+  // Workers park on the shared idle waiter between messages; each send and
+  // the final stop() must reach one that is asleep.
+  for (int round = 0; round < 20; round++)
+  {
+    std::vector<long> state(4);
+    system_type sys(4, 4);
+    sys.start([&](std::size_t a, system_type::value_type& m) { m->handle(state[a]); });
+    for (long i = 0; i < 5; i++)
+    {
+      std::this_thread::sleep_for(1ms);
+      while (not sys.send<add_msg>(i % 4, 1))
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(1ms);
+    sys.stop();
+    ASSERT_EQ(5, state[0] + state[1] + state[2] + state[3]);
+  }
+}
+
+TEST(perftest, actor_system_scaling)
+{
+  const std::size_t actors = 1 << 18;
+  const long count = 2000000;
+  std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t workers = 1; workers <= cores; workers *= 2)
+  {
+    msg::allocations = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    run_actors(actors, workers, 1, count);
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << actors << " actors on " << workers << " workers processed " << count * 1s / (t1 - t0)
+              << " msgs per second with " << msg::allocations << " allocations.\n";
+  }
+}
@@ -0,0 +1,247 @@
+#include "ddw/any_range.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+// Range that generates [0, n) without any storage.
+struct iota
+{
+  struct iterator
+  {
+    long i;
+    long operator*() const { return i; }
+    iterator& operator++() { ++i; return *this; }
+    bool operator!=(const iterator& o) const { return i != o.i; }
+  };
+
+  long n;
+  iterator begin() const { return {0}; }
+  iterator end() const { return {n}; }
+};
+
+}
+
+TEST(any_range, container_by_reference)
+{
+  std::vector<long> v{1, 2, 3};
+  ddw::any_range<const long&> r(v);
+  long sum = 0;
+  for (auto& x : r)
+    sum += x;
+  ASSERT_EQ(6, sum);
+  v.push_back(4);
+  sum = 0;
+  for (auto& x : r)
+    sum += x;
+  ASSERT_EQ(10, sum);
+}
+
+TEST(any_range, view_by_value)
+{
+  ddw::any_range<long> r(iota{5});
+  std::list<long> l{10, 20};
+  ddw::any_range<long> r2(l);
+  long sum = 0;
+  for (long x : r)
+    sum += x;
+  for (long x : r2)
+    sum += x;
+  ASSERT_EQ(40, sum);
+}
+
+TEST(any_range, next_n)
+{
+  ddw::any_range<long> r(iota{10});
+  auto it = r.begin();
+  long buffer[4];
+  ASSERT_EQ(4u, it.next_n(buffer, 4));
+  ASSERT_EQ(3, buffer[3]);
+  ASSERT_EQ(4, *it);
+  ++it;
+  ASSERT_EQ(4u, it.next_n(buffer, 4));
+  ASSERT_EQ(5, buffer[0]);
+  ASSERT_EQ(1u, it.next_n(buffer, 4));
+  ASSERT_EQ(9, buffer[0]);
+  ASSERT_EQ(0u, it.next_n(buffer, 4));
+  ASSERT_TRUE(it == ddw::any_sentinel());
+}
+
+TEST(any_range, empty)
+{
+  ddw::any_range<long> r;
+  ASSERT_TRUE(r.begin() == r.end());
+  long buffer[1];
+  ASSERT_EQ(0u, r.begin().next_n(buffer, 1));
+}
+
+namespace
+{
+
+struct counter
+{
+  virtual ~counter() {}
+  virtual long value() const = 0;
+};
+
+struct fixed : counter
+{
+  fixed(long v) : v(v) {}
+  long value() const override { return v; }
+  long v;
+};
+
+}
+
+TEST(any_range, move_only_elements)
+{
+  std::vector<ddw::impl<counter>> counters;
+  for (long i = 1; i <= 3; i++)
+    counters.emplace_back(fixed(i));
+  ddw::any_range<ddw::impl<counter>&> r(counters);
+  long sum = 0;
+  for (auto& c : r)
+    sum += c->value();
+  ASSERT_EQ(6, sum);
+
+  std::vector<std::unique_ptr<long>> pointers;
+  pointers.push_back(std::make_unique<long>(4));
+  ddw::any_range<std::unique_ptr<long>&> r2(pointers);
+  for (auto& p : r2)
+    sum += *p;
+  ASSERT_EQ(10, sum);
+}
+
+// The interface that any_range replaces: one allocation per begin() and two
+// virtual calls per element. Outside the anonymous namespace, so that the
+// compiler cannot see all overriders and devirtualize the calls.
+struct long_iterator
+{
+  virtual ~long_iterator() {}
+  virtual bool next(long& out) = 0;
+};
+
+struct vector_long_iterator : long_iterator
+{
+  std::vector<long>::const_iterator it, end;
+  vector_long_iterator(const std::vector<long>& v) : it(v.begin()), end(v.end()) {}
+  bool next(long& out) override
+  {
+    if (it == end) return false;
+    out = *it++;
+    return true;
+  }
+};
+
+struct list_long_iterator : long_iterator
+{
+  std::list<long>::const_iterator it, end;
+  list_long_iterator(const std::list<long>& l) : it(l.begin()), end(l.end()) {}
+  bool next(long& out) override
+  {
+    if (it == end) return false;
+    out = *it++;
+    return true;
+  }
+};
+
+struct long_sequence
+{
+  virtual ~long_sequence() {}
+  virtual std::unique_ptr<long_iterator> begin() const = 0;
+};
+
+struct vector_sequence : long_sequence
+{
+  const std::vector<long>& v;
+  vector_sequence(const std::vector<long>& v) : v(v) {}
+  std::unique_ptr<long_iterator> begin() const override { return std::make_unique<vector_long_iterator>(v); }
+};
+
+struct list_sequence : long_sequence
+{
+  const std::list<long>& l;
+  list_sequence(const std::list<long>& l) : l(l) {}
+  std::unique_ptr<long_iterator> begin() const override { return std::make_unique<list_long_iterator>(l); }
+};
+
+namespace
+{
+
+__attribute__((noinline)) std::unique_ptr<long_sequence> make_sequence(const std::vector<long>& v)
+{
+  return std::make_unique<vector_sequence>(v);
+}
+
+const long range_size = 1000;
+const long range_rounds = 20000;
+
+template<typename F>
+void report(const char* name, F sum)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  long total = 0;
+  for (long i = 0; i < range_rounds; i++)
+    total += sum();
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << name << " iterated " << range_size * range_rounds * 1s / (t1 - t0) << " elements per second.\n";
+  ASSERT_EQ(range_rounds * range_size * (range_size - 1) / 2, total);
+}
+
+std::vector<long> range_data()
+{
+  std::vector<long> v(range_size);
+  std::iota(v.begin(), v.end(), 0);
+  return v;
+}
+
+}
+
+TEST(perftest, virtual_iterator)
+{
+  auto v = range_data();
+  auto seq = make_sequence(v);
+  report("hand-written virtual iterator", [&]()
+  {
+    long sum = 0, x;
+    for (auto it = seq->begin(); it->next(x); )
+      sum += x;
+    return sum;
+  });
+}
+
+TEST(perftest, any_range_per_element)
+{
+  auto v = range_data();
+  ddw::any_range<const long&> r(v);
+  report("ddw::any_range per element", [&]()
+  {
+    long sum = 0;
+    for (auto& x : r)
+      sum += x;
+    return sum;
+  });
+}
+
+TEST(perftest, any_range_next_n)
+{
+  auto v = range_data();
+  ddw::any_range<const long&> r(v);
+  report("ddw::any_range next_n(256)", [&]()
+  {
+    long sum = 0;
+    long buffer[256];
+    auto it = r.begin();
+    while (std::size_t n = it.next_n(buffer, 256))
+      for (std::size_t i = 0; i < n; i++)
+        sum += buffer[i];
+    return sum;
+  });
+}
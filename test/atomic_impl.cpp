@@ -0,0 +1,204 @@
+#include "ddw/atomic_impl.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct strategy
+{
+  virtual ~strategy() {}
+  virtual int price(int qty) const = 0;
+};
+
+struct linear : strategy
+{
+  static std::atomic<int> alive;
+  linear(int f) : factor(f) { alive++; }
+  linear(const linear& o) : factor(o.factor) { alive++; }
+  linear(linear&& o) : factor(o.factor) { alive++; }
+  ~linear() { factor = -1; alive--; }
+  int price(int qty) const override { return qty * factor; }
+  int factor;
+};
+std::atomic<int> linear::alive{0};
+
+}
+
+TEST(atomic_impl, store_and_read)
+{
+  {
+    ddw::atomic_impl<strategy> s = linear(2);
+    ASSERT_EQ(20, s.read()->price(10));
+    s.store(linear(3));
+    ASSERT_EQ(30, s.read()->price(10));
+    s.emplace<linear>(4);
+    {
+      auto g = s.read();
+      auto nested = s.read();
+      ASSERT_EQ(40, g->price(10));
+      ASSERT_EQ(&*g, &*nested);
+    }
+    ASSERT_EQ(1, linear::alive);
+  }
+  ASSERT_EQ(0, linear::alive);
+}
+
+TEST(atomic_impl, empty)
+{
+  ddw::atomic_impl<strategy> s;
+  ASSERT_FALSE(s.read());
+}
+
+TEST(atomic_impl, store_inside_read_section)
+{
+  {
+    ddw::atomic_impl<strategy> s = linear(2);
+    {
+      auto r = s.read();
+      s.store(linear(3));
+      ASSERT_EQ(20, r->price(10));
+      ASSERT_EQ(30, s.read()->price(10));
+    }
+    ASSERT_EQ(2, linear::alive);
+    s.store(linear(4));
+    ASSERT_EQ(1, linear::alive);
+  }
+  ASSERT_EQ(0, linear::alive);
+}
+
+TEST(atomic_impl, store_inside_read_section_while_another_thread_stores)
+{
+  {
+    ddw::atomic_impl<strategy> s = linear(1);
+    for (int round = 0; round < 20; round++)
+    {
+      std::atomic<bool> reading{false};
+      std::thread other([&]()
+      {
+        while (not reading)
+          std::this_thread::yield();
+        // Waits for the reader below in synchronize() while it stores.
+        s.store(linear(2));
+      });
+      {
+        auto r = s.read();
+        reading = true;
+        std::this_thread::sleep_for(1ms);
+        s.store(linear(3));
+        ASSERT_GT(r->price(1), 0);
+      }
+      other.join();
+    }
+    s.store(linear(4));
+    ASSERT_EQ(1, linear::alive);
+  }
+  ASSERT_EQ(0, linear::alive);
+}
+
+TEST(atomic_impl, readers_never_see_reclaimed)
+{
+  ddw::atomic_impl<strategy> s = linear(1);
+  std::atomic<bool> stop{false};
+  std::atomic<long> bad{0};
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; r++)
+  {
+    readers.emplace_back([&]()
+    {
+      while (not stop)
+      {
+        auto g = s.read();
+        if (g->price(1) <= 0) bad++;
+      }
+    });
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 2; std::chrono::steady_clock::now() - t0 < 50ms; i++)
+    s.store(linear(i));
+  stop = true;
+  for (auto& t : readers)
+    t.join();
+  ASSERT_EQ(0, bad);
+}
+
+namespace
+{
+
+template<typename Read, typename Write>
+void perftest_readers(const char* description, int readers, Read read, Write write)
+{
+  std::atomic<bool> stop{false};
+  std::vector<long> reads(readers);
+  std::vector<std::thread> threads;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < readers; r++)
+  {
+    threads.emplace_back([&, r]()
+    {
+      long n = 0;
+      long sum = 0;
+      while (not stop.load(std::memory_order_relaxed))
+      {
+        for (int i = 0; i < 1000; i++)
+          sum += read(i);
+        n += 1000;
+      }
+      reads[r] = sum ? n : 0;
+    });
+  }
+  int version = 1;
+  while (std::chrono::steady_clock::now() - t0 < 250ms)
+  {
+    write(++version);
+    std::this_thread::sleep_for(1ms);
+  }
+  stop = true;
+  for (auto& t : threads)
+    t.join();
+  auto t1 = std::chrono::steady_clock::now();
+  long total = 0;
+  for (long n : reads)
+    total += n;
+
+  std::cout << description << " with " << readers << " readers performed " << total * 1s / (t1 - t0) << " reads per second.\n";
+
+  ASSERT_NE(0, total);
+}
+
+std::vector<int> reader_counts()
+{
+  int hw = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<int> counts;
+  for (int n = 1; n < hw; n *= 2)
+    counts.push_back(n);
+  counts.push_back(hw);
+  return counts;
+}
+
+}
+
+TEST(perftest, atomic_impl_readers)
+{
+  ddw::atomic_impl<strategy> s = linear(1);
+  for (int readers : reader_counts())
+    perftest_readers("ddw::atomic_impl<strategy>", readers,
+        [&s](int i) { return s.read()->price(i); },
+        [&s](int v) { s.store(linear(v)); });
+}
+
+TEST(perftest, atomic_shared_ptr_readers)
+{
+  std::shared_ptr<const strategy> s = std::make_shared<linear>(1);
+  for (int readers : reader_counts())
+    perftest_readers("atomic std::shared_ptr<strategy>", readers,
+        [&s](int i) { return std::atomic_load(&s)->price(i); },
+        [&s](int v) { std::atomic_store(&s, std::shared_ptr<const strategy>(std::make_shared<linear>(v))); });
+}
@@ -0,0 +1,49 @@
+#include "ddw/impl.hpp"
+#include <utility>
+#include <vector>
+
+#ifndef BLOAT_TYPES
+#define BLOAT_TYPES 200
+#endif
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual int handle() = 0;
+};
+
+template<int I>
+struct msg_n : msg
+{
+  int payload[I % 12 + 1] = {I};
+  int handle() override { return payload[0]; }
+};
+
+#ifndef BLOAT_NO_FOLDING
+namespace ddw
+{
+template<int I>
+struct impl_trivially_movable<msg_n<I>> : std::true_type {};
+}
+#endif
+
+template<int... I>
+void post_all(std::vector<ddw::impl<msg>>& queue, std::integer_sequence<int, I...>)
+{
+  (queue[I].reset(msg_n<I>()), ...);
+}
+
+int main()
+{
+  std::vector<ddw::impl<msg>> queue(BLOAT_TYPES);
+  post_all(queue, std::make_integer_sequence<int, BLOAT_TYPES>());
+  std::vector<ddw::impl<msg>> moved;
+  moved.reserve(BLOAT_TYPES);
+  int sum = 0;
+  for (auto& m : queue)
+  {
+    moved.emplace_back(std::move(m));
+    sum += moved.back()->handle();
+  }
+  return sum == BLOAT_TYPES * (BLOAT_TYPES - 1) / 2 ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Compiles bloat.cpp with and without move thunk folding and reports the code
+# size and compile time of each.
+# usage: report.sh <compiler> <include dir> <number of types>
+
+cxx=$1
+inc=$2
+types=$3
+src=$(dirname "$0")/bloat.cpp
+obj=${TMPDIR:-/tmp}/ddw-bloat-$$.o
+
+for mode in folded unfolded
+do
+  flags=""
+  [ $mode = unfolded ] && flags=-DBLOAT_NO_FOLDING
+  t0=$(date +%s%N)
+  $cxx -std=c++17 -O3 -I"$inc" -DBLOAT_TYPES="$types" $flags -c "$src" -o "$obj" || exit 1
+  t1=$(date +%s%N)
+  text=$(size -A "$obj" | awk '$1 ~ /^\.text/ { s += $2 } END { print s }')
+  echo "$mode: $types message types, $text bytes of code, compiled in $(( (t1 - t0) / 1000000 )) ms"
+done
+rm -f "$obj"
@@ -0,0 +1,116 @@
+#include "ddw/channel.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual void handle() = 0;
+};
+
+struct count_msg : msg
+{
+  int& counter;
+  count_msg(int& c) : counter(c) {}
+  void handle() override { counter++; }
+};
+
+struct done_msg : msg
+{
+  bool& done;
+  done_msg(bool& d) : done(d) {}
+  void handle() override { done = true; }
+};
+
+using msg_channel = ddw::channel<msg, 32, sizeof(void*), 64>;
+
+ddw::task consume(msg_channel& ch, bool& done)
+{
+  while (not done)
+  {
+    auto m = co_await ch.pop();
+    m->handle();
+  }
+}
+
+std::atomic<int> failed_pushes{0};
+
+ddw::task produce(msg_channel& ch, int& counter, bool& done, int count)
+{
+  for (int i = 0; i < count; i++)
+    if (not co_await ch.push(count_msg(counter)))
+      failed_pushes++;
+  if (not co_await ch.push(done_msg(done)))
+    failed_pushes++;
+}
+
+}
+
+TEST(channel, consumer_first)
+{
+  msg_channel ch;
+  int counter = 0;
+  bool done = false;
+  auto c = consume(ch, done);
+  ASSERT_FALSE(c.done());
+  auto p = produce(ch, counter, done, 1000);
+  ASSERT_TRUE(p.done());
+  ASSERT_TRUE(c.done());
+  ASSERT_EQ(1000, counter);
+}
+
+TEST(channel, producer_first)
+{
+  msg_channel ch;
+  int counter = 0;
+  bool done = false;
+  auto p = produce(ch, counter, done, 1000);
+  ASSERT_FALSE(p.done());
+  ASSERT_TRUE(ch.full());
+  auto c = consume(ch, done);
+  ASSERT_TRUE(p.done());
+  ASSERT_TRUE(c.done());
+  ASSERT_EQ(1000, counter);
+}
+
+TEST(channel, across_threads)
+{
+  msg_channel ch;
+  int counter = 0;
+  bool done = false;
+  std::optional<ddw::task> c;
+  std::optional<ddw::task> p;
+  failed_pushes = 0;
+  std::thread reader([&]() { c.emplace(consume(ch, done)); });
+  std::thread writer([&]() { p.emplace(produce(ch, counter, done, 100000)); });
+  reader.join();
+  writer.join();
+  ASSERT_TRUE(c->done());
+  ASSERT_TRUE(p->done());
+  ASSERT_EQ(0, failed_pushes);
+  ASSERT_EQ(100000, counter);
+}
+
+TEST(perftest, channel_impl)
+{
+  msg_channel ch;
+  int counter = 0;
+  int expected_counter = 5000000;
+  bool done = false;
+  auto t0 = std::chrono::steady_clock::now();
+  auto c = consume(ch, done);
+  auto p = produce(ch, counter, done, expected_counter);
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << "channel holding small ddw::impl<msg> objects processed " << counter * 1s / (t1 - t0) << " msgs per second.\n";
+
+  ASSERT_EQ(expected_counter, counter);
+}
@@ -0,0 +1,153 @@
+#include "ddw/impl.hpp"
+#include "coalescing_fifo.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual void handle() = 0;
+};
+
+struct add_msg : msg
+{
+  long& counter;
+  long n;
+  add_msg(long& c, long n = 1) : counter(c), n(n) {}
+  void merge(add_msg&& o) { n += o.n; }
+  void handle() override { counter += n; }
+};
+
+struct other_add_msg : add_msg
+{
+  using add_msg::add_msg;
+  void merge(other_add_msg&& o) { n += o.n; }
+};
+
+struct plain_msg : msg
+{
+  long& counter;
+  plain_msg(long& c) : counter(c) {}
+  void handle() override { counter++; }
+};
+
+using queue = coalescing_fifo<msg>;
+
+long consume(queue& q, long& handled)
+{
+  long slots = 0;
+  while (not q.empty())
+  {
+    q.front()->handle();
+    q.pop();
+    slots++;
+    handled++;
+  }
+  return slots;
+}
+
+}
+
+TEST(coalescing_fifo, merges_unpublished_same_type)
+{
+  auto q = std::make_unique<queue>();
+  long counter = 0, handled = 0;
+  ASSERT_TRUE(q->push(add_msg(counter, 2)));
+  ASSERT_FALSE(q->push(add_msg(counter, 3)));
+  ASSERT_TRUE(q->push(plain_msg(counter)));
+  ASSERT_TRUE(q->push(add_msg(counter)));
+  ASSERT_TRUE(q->push(other_add_msg(counter)));
+  ASSERT_FALSE(q->push(other_add_msg(counter)));
+  q->flush();
+  ASSERT_EQ(4, consume(*q, handled));
+  ASSERT_EQ(9, counter);
+}
+
+TEST(coalescing_fifo, never_merges_into_references)
+{
+  auto q = std::make_unique<queue>();
+  long counter = 0, handled = 0;
+  add_msg caller(counter, 2);
+  ASSERT_TRUE(q->push(caller));
+  ASSERT_TRUE(q->push(add_msg(counter, 3)));
+  ASSERT_TRUE(q->push(caller));
+  q->flush();
+  ASSERT_EQ(3, consume(*q, handled));
+  ASSERT_EQ(2, caller.n);
+  ASSERT_EQ(7, counter);
+}
+
+TEST(coalescing_fifo, never_merges_published)
+{
+  auto q = std::make_unique<queue>();
+  long counter = 0, handled = 0;
+  ASSERT_TRUE(q->push(add_msg(counter)));
+  q->flush();
+  ASSERT_TRUE(q->push(add_msg(counter)));
+  q->flush();
+  ASSERT_EQ(2, consume(*q, handled));
+  ASSERT_EQ(2, counter);
+}
+
+namespace
+{
+
+template<typename M>
+void run_bursts(const char* name)
+{
+  const long bursts = 1000;
+  const long burst = 10000;
+  auto q = std::make_unique<queue>();
+  long counter = 0;
+  long handled = 0;
+  bool done = false;
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread writer([&]()
+  {
+    for (long b = 0; b < bursts; b++)
+    {
+      for (long i = 0; i < burst; i++)
+      {
+        while (q->full())
+          std::this_thread::yield();
+        q->push(M(counter));
+      }
+      q->flush();
+    }
+  });
+  std::thread reader([&]()
+  {
+    while (not done)
+    {
+      handled += q->drain(256, [](queue::value_type& m) { m->handle(); });
+      done = counter == bursts * burst;
+      if (not done and q->empty()) std::this_thread::yield();
+    }
+  });
+  writer.join();
+  reader.join();
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << "coalescing fifo holding " << name << " processed " << counter * 1s / (t1 - t0)
+            << " msgs per second in " << handled << " handler calls.\n";
+  ASSERT_EQ(bursts * burst, counter);
+}
+
+}
+
+TEST(perftest, coalescing_fifo_plain_bursts)
+{
+  run_bursts<plain_msg>("plain messages");
+}
+
+TEST(perftest, coalescing_fifo_merged_bursts)
+{
+  run_bursts<add_msg>("mergeable messages");
+}
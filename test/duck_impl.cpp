@@ -0,0 +1,168 @@
+#include "ddw/duck_impl.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+DDW_IMPL_METHOD(print, void(std::ostream&));
+DDW_IMPL_METHOD(id, int());
+DDW_IMPL_METHOD(resize, void(int));
+
+struct jpg
+{
+  void print(std::ostream& os) { os << "jpg" << n; }
+  int id() { return n; }
+  void resize(int f) { n *= f; }
+  int n;
+};
+
+struct pdf
+{
+  void print(std::ostream& os) { os << "pdf" << n; }
+  int id() { return n; }
+  void resize(int f) { n += f; }
+  int n;
+  int pages[64] = {};
+};
+
+struct only_owner
+{
+  only_owner(int n) : p(std::make_unique<int>(n)) {}
+  void print(std::ostream& os) { os << "owner" << *p; }
+  int id() { return *p; }
+  std::unique_ptr<int> p;
+};
+
+struct pinned
+{
+  pinned(int n) : n(n) {}
+  pinned(pinned&&) = delete;
+  void print(std::ostream& os) { os << "pinned" << n; }
+  int id() { return n; }
+  int n;
+};
+
+using doc = ddw::duck_impl<ddw::interface<print, id>>;
+using editable_doc = ddw::duck_impl<ddw::interface<print, id, resize>>;
+
+std::string to_string(doc& d)
+{
+  std::ostringstream os;
+  d.call<print>(os);
+  return os.str();
+}
+
+}
+
+TEST(duck_impl, inline_and_heap)
+{
+  doc small = jpg{1};
+  doc large = pdf{2};
+  ASSERT_EQ("jpg1", to_string(small));
+  ASSERT_EQ("pdf2", to_string(large));
+  doc moved = std::move(large);
+  ASSERT_EQ(2, moved.call<id>());
+  ASSERT_LT(sizeof(doc), sizeof(ddw::impl<jpg>) + 3 * sizeof(void*));
+}
+
+TEST(duck_impl, by_reference)
+{
+  jpg j{3};
+  doc d = ddw::impl_by_reference(j);
+  j.n = 4;
+  ASSERT_EQ("jpg4", to_string(d));
+}
+
+TEST(duck_impl, move_only)
+{
+  doc d = only_owner(5);
+  doc d2 = std::move(d);
+  ASSERT_EQ(5, d2.call<id>());
+  d = std::move(d2);
+  ASSERT_EQ("owner5", to_string(d));
+}
+
+TEST(duck_impl, emplace_non_movable)
+{
+  doc d;
+  d.emplace<pinned>(6);
+  ASSERT_EQ("pinned6", to_string(d));
+  doc d2 = std::move(d);
+  ASSERT_EQ(6, d2.call<id>());
+}
+
+TEST(duck_impl, table_dispatch)
+{
+  editable_doc d = jpg{3};
+  d.call<resize>(2);
+  ASSERT_EQ(6, d.call<id>());
+  d = pdf{3};
+  d.call<resize>(2);
+  ASSERT_EQ(5, d.call<id>());
+  ASSERT_FALSE(editable_doc());
+}
+
+namespace
+{
+
+struct counted
+{
+  virtual ~counted() {}
+  virtual int id() = 0;
+};
+
+template<int I>
+struct counted_impl : counted
+{
+  int id() override { return I; }
+};
+
+template<int I>
+struct plain_impl
+{
+  int id() { return I; }
+};
+
+template<typename T, typename F>
+void perftest_calls(const char* description, std::vector<T>& v, F call)
+{
+  long sum = 0;
+  long count = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - t0 < 1s)
+  {
+    for (auto& x : v)
+      sum += call(x);
+    count += v.size();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << description << " of " << sizeof(T) << " bytes performed " << count * 1s / (t1 - t0) << " calls per second.\n";
+
+  ASSERT_NE(0, sum);
+}
+
+}
+
+TEST(perftest, virtual_impl_calls)
+{
+  std::vector<ddw::impl<counted>> v(1 << 16);
+  for (std::size_t i = 0; i < v.size(); i++)
+    if (i % 2) v[i] = counted_impl<1>(); else v[i] = counted_impl<2>();
+  perftest_calls("ddw::impl<counted>", v, [](ddw::impl<counted>& c) { return c->id(); });
+}
+
+TEST(perftest, duck_impl_calls)
+{
+  using counted_duck = ddw::duck_impl<ddw::interface<id>>;
+  std::vector<counted_duck> v(1 << 16);
+  for (std::size_t i = 0; i < v.size(); i++)
+    if (i % 2) v[i] = plain_impl<1>(); else v[i] = plain_impl<2>();
+  perftest_calls("ddw::duck_impl<interface<id>>", v, [](counted_duck& c) { return c.call<id>(); });
+}
@@ -0,0 +1,119 @@
+#include "ddw/impl.hpp"
+#include "executor.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct task
+{
+  virtual ~task() {}
+  virtual void run() = 0;
+};
+
+struct alignas(64) counter
+{
+  long value = 0;
+};
+
+struct count_task : task
+{
+  long& value;
+  count_task(long& v) : value(v) {}
+  void run() override { value++; }
+};
+
+using executor = sharded_executor<task>;
+
+std::vector<int> first_cpus(std::size_t n)
+{
+  std::vector<int> cpus(n);
+  int hw = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t i = 0; i < n; i++)
+    cpus[i] = i % hw;
+  return cpus;
+}
+
+long run_sharded(std::size_t cores, std::chrono::nanoseconds duration, long& expected)
+{
+  executor ex(cores, first_cpus(cores));
+  std::vector<counter> counters(cores);
+  ex.start([](executor::value_type& t) { t->run(); });
+  std::vector<std::thread> producers;
+  std::vector<long> posted(cores);
+  auto t0 = std::chrono::steady_clock::now();
+  for (std::size_t p = 0; p < cores; p++)
+  {
+    producers.emplace_back([&, p]()
+    {
+      pin_to_cpu(pthread_self(), first_cpus(cores)[p]);
+      while (std::chrono::steady_clock::now() - t0 < duration)
+      {
+        for (int i = 0; i < 10000; i++)
+        {
+          std::size_t w = (p + i) % cores;
+          ex.post(p, w, count_task(counters[w].value));
+        }
+        posted[p] += 10000;
+      }
+      ex.flush(p);
+    });
+  }
+  for (auto& t : producers)
+    t.join();
+  ex.stop();
+  long handled = 0;
+  for (std::size_t w = 0; w < cores; w++)
+  {
+    handled += counters[w].value;
+    expected += posted[w];
+  }
+  return handled;
+}
+
+}
+
+TEST(sharded_executor, handles_all_tasks)
+{
+  executor ex(2, first_cpus(3));
+  std::vector<counter> counters(3);
+  ex.start([](executor::value_type& t) { t->run(); });
+  std::thread second([&]()
+  {
+    for (int i = 0; i < 30000; i++)
+      ex.post(1, i % 3, count_task(counters[i % 3].value));
+    ex.flush(1);
+  });
+  for (int i = 0; i < 30000; i++)
+    ex.post(0, i % 3, count_task(counters[i % 3].value));
+  ex.flush(0);
+  second.join();
+  ex.stop();
+  for (auto& c : counters)
+    ASSERT_EQ(20000, c.value);
+}
+
+TEST(perftest, sharded_executor_scaling)
+{
+  std::size_t hw = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::size_t> scales;
+  for (std::size_t cores : {2, 4, 8})
+    if (cores < hw) scales.push_back(cores);
+  scales.push_back(hw);
+  for (std::size_t cores : scales)
+  {
+    long expected = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    long handled = run_sharded(cores, 250ms, expected);
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::cout << "sharded executor on " << cores << " cores processed " << handled * 1s / (t1 - t0) << " msgs per second.\n";
+
+    ASSERT_EQ(expected, handled);
+  }
+}
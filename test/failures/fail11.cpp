@@ -0,0 +1,8 @@
+#include "ddw/fn.hpp"
+
+int main()
+{
+  int arr[16] = {};
+  ddw::fn<int()> f = ddw::impl_by_small_value([arr]() { return arr[0]; });
+  return f();
+}
@@ -0,0 +1,18 @@
+#include "ddw/impl.hpp"
+
+struct A
+{
+  virtual ~A() {}
+  virtual int zero() { return 0; }
+};
+
+struct B : A
+{
+  int zero() override { return 0; }
+};
+
+int main()
+{
+  ddw::impl<A> a = ddw::impl_by_reference(B());
+  return a->zero();
+}
@@ -0,0 +1,7 @@
+#include "ddw/fn.hpp"
+
+int main()
+{
+  ddw::fn<int()> f = ddw::impl_by_reference([]() { return 1; });
+  return f();
+}
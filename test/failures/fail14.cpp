@@ -0,0 +1,14 @@
+#include "ddw/duck_impl.hpp"
+
+DDW_IMPL_METHOD(id, int());
+
+struct doc
+{
+  int id() { return 0; }
+};
+
+int main()
+{
+  ddw::duck_impl<ddw::interface<id>> d = ddw::impl_by_reference(doc());
+  return d.call<id>();
+}
@@ -0,0 +1,11 @@
+#include "ddw/any_range.hpp"
+#include <memory>
+#include <vector>
+
+int main()
+{
+  std::vector<std::unique_ptr<int>> v;
+  ddw::any_range<std::unique_ptr<int>&> r(v);
+  std::unique_ptr<int> buffer[4];
+  return int(r.begin().next_n(buffer, 4));
+}
@@ -0,0 +1,50 @@
+#include "ddw/fn.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+TEST(fn, move_only_lambda)
+{
+  auto p = std::make_unique<int>(41);
+  ddw::fn<int(int)> f = [p = std::move(p)](int x) { return *p + x; };
+  ASSERT_EQ(42, f(1));
+  ddw::fn<int(int)> g = std::move(f);
+  ASSERT_EQ(43, g(2));
+}
+
+TEST(fn, empty)
+{
+  ddw::fn<void()> f;
+  ASSERT_FALSE(f);
+  f = [] {};
+  ASSERT_TRUE(f);
+}
+
+TEST(fn, by_reference)
+{
+  int calls = 0;
+  auto counter = [&calls]() mutable { return ++calls; };
+  ddw::fn<int()> f1 = std::ref(counter);
+  ddw::fn<int()> f2 = ddw::impl_by_reference(counter);
+  f1();
+  f2();
+  ASSERT_EQ(2, calls);
+  ASSERT_EQ(3, counter());
+}
+
+TEST(fn, forced_small_value)
+{
+  std::string prefix = "impl";
+  ddw::fn<std::string(const std::string&), 64> f = ddw::impl_by_small_value(
+      [prefix](const std::string& s) { return prefix + s; });
+  ASSERT_EQ("impl<T>", f("<T>"));
+}
+
+TEST(fn, large_capture_spills)
+{
+  struct large { int arr[64] = {1}; };
+  ddw::fn<int()> f = [l = large()]() { return l.arr[0]; };
+  ASSERT_EQ(1, f());
+  ddw::fn<int(), sizeof(large) + sizeof(void*)> g = [l = large()]() { return l.arr[0] + 1; };
+  ASSERT_EQ(2, g());
+}
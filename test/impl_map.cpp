@@ -0,0 +1,130 @@
+#include "ddw/impl_map.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct handler
+{
+  virtual ~handler() {}
+  virtual int handle(int arg) = 0;
+};
+
+struct add_handler : handler
+{
+  add_handler(int v) : v(v) {}
+  int handle(int arg) override { return arg + v; }
+  int v;
+};
+
+struct big_handler : handler
+{
+  big_handler(int v) : v(v) {}
+  int handle(int arg) override { return arg * v; }
+  int v;
+  int unused[32] = {};
+};
+
+struct fixed_handler : handler
+{
+  int handle(int) override { return -1; }
+};
+
+}
+
+TEST(impl_map, insert_find_erase)
+{
+  ddw::impl_map<int, handler> m;
+  for (int i = 0; i < 1000; i++)
+  {
+    if (i % 10 == 0)
+      m.insert_or_assign(i, big_handler(i));
+    else
+      m.emplace<add_handler>(i, i);
+  }
+  ASSERT_EQ(1000u, m.size());
+  for (int i = 0; i < 1000; i++)
+    ASSERT_EQ(i % 10 == 0 ? 2 * i : 2 + i, m.find(i)->handle(2));
+  ASSERT_EQ(nullptr, m.find(1000));
+  for (int i = 0; i < 1000; i += 2)
+    ASSERT_TRUE(m.erase(i));
+  ASSERT_FALSE(m.erase(0));
+  ASSERT_EQ(500u, m.size());
+  for (int i = 0; i < 1000; i++)
+    ASSERT_EQ(i % 2 == 1, m.contains(i));
+  for (int i = 1; i < 1000; i += 2)
+    ASSERT_EQ(i % 10 == 0 ? 2 * i : 2 + i, m.find(i)->handle(2));
+}
+
+TEST(impl_map, assign_replaces)
+{
+  fixed_handler fixed;
+  ddw::impl_map<int, handler> m;
+  m.insert_or_assign(7, add_handler(1));
+  m.insert_or_assign(7, fixed);
+  ASSERT_EQ(1u, m.size());
+  ASSERT_EQ(&fixed, m.find(7));
+  m.clear();
+  ASSERT_TRUE(m.empty());
+  ASSERT_FALSE(m.contains(7));
+}
+
+namespace
+{
+
+template<typename Lookup>
+void perftest_lookup(const char* description, const std::vector<int>& keys, Lookup lookup)
+{
+  long sum = 0;
+  long count = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - t0 < 1s)
+  {
+    for (int k : keys)
+      sum += lookup(k)->handle(1);
+    count += keys.size();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << description << " dispatched " << count * 1s / (t1 - t0) << " lookups per second.\n";
+
+  ASSERT_NE(0, sum);
+}
+
+const int handler_count = 100000;
+
+std::vector<int> random_keys()
+{
+  std::vector<int> keys(1 << 20);
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0, handler_count - 1);
+  for (int& k : keys)
+    k = dist(gen);
+  return keys;
+}
+
+}
+
+TEST(perftest, impl_map_lookup)
+{
+  ddw::impl_map<int, handler> m(handler_count);
+  for (int i = 0; i < handler_count; i++)
+    m.emplace<add_handler>(i, i);
+  perftest_lookup("ddw::impl_map<int, handler>", random_keys(), [&m](int k) { return m.find(k); });
+}
+
+TEST(perftest, unordered_map_lookup)
+{
+  std::unordered_map<int, std::unique_ptr<handler>> m(handler_count);
+  for (int i = 0; i < handler_count; i++)
+    m.emplace(i, std::make_unique<add_handler>(i));
+  perftest_lookup("std::unordered_map<int, std::unique_ptr<handler>>", random_keys(),
+      [&m](int k) { return m.find(k)->second.get(); });
+}
@@ -0,0 +1,235 @@
+#ifndef TEST_ACTOR_H_
+#define TEST_ACTOR_H_
+
+#include "ddw/impl.hpp"
+#include "wait_strategy.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Bounded multi-producer multi-consumer ring of actor indices (Vyukov's
+// per-slot sequence numbers). Its capacity is rounded up to a power of two.
+struct actor_run_queue
+{
+  explicit actor_run_queue(std::size_t capacity)
+  {
+    while (mask + 1 < capacity)
+      mask = mask * 2 + 1;
+    cells = std::make_unique<cell[]>(mask + 1);
+    for (std::size_t i = 0; i <= mask; i++)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool push(std::uint32_t v)
+  {
+    std::size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell& c = cells[pos & mask];
+      std::size_t seq = c.seq.load(std::memory_order_acquire);
+      if (seq == pos)
+      {
+        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          c.value = v;
+          c.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (seq < pos)
+        return false;
+      else
+        pos = tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  bool pop(std::uint32_t& v)
+  {
+    std::size_t pos = head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell& c = cells[pos & mask];
+      std::size_t seq = c.seq.load(std::memory_order_acquire);
+      if (seq == pos + 1)
+      {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          v = c.value;
+          c.seq.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (seq < pos + 1)
+        return false;
+      else
+        pos = head.load(std::memory_order_relaxed);
+    }
+  }
+
+private:
+  struct cell
+  {
+    std::atomic<std::size_t> seq;
+    std::uint32_t value;
+  };
+
+  std::size_t mask = 0;
+  std::unique_ptr<cell[]> cells;
+  alignas(64) std::atomic<std::size_t> tail{0};
+  alignas(64) std::atomic<std::size_t> head{0};
+};
+
+// Actors with mailboxes of M inline ddw::impl<T, C, A> messages, run on a
+// fixed pool of worker threads. An actor is put on the run queue by the send
+// that finds it idle, and stays off it while it has no messages, so idle
+// actors cost nothing but their mailbox. A worker that picks an actor handles
+// up to Batch of its messages in a row before rescheduling it. Messages are
+// constructed in their mailbox slot, so types that fit inline are sent
+// without any allocation.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*),
+    std::size_t M = 8, std::size_t Batch = 64>
+struct actor_system
+{
+  using value_type = ddw::impl<T, C, A>;
+
+  actor_system(std::size_t actors, std::size_t workers)
+      : mailboxes(std::make_unique<mailbox[]>(actors)), runnable(actors), workers(workers) {}
+
+  actor_system(const actor_system&) = delete;
+
+  ~actor_system()
+  {
+    stop();
+  }
+
+  // Starts the workers; handler(actor, value_type&) is called for every message.
+  template<typename F>
+  void start(F handler)
+  {
+    for (std::size_t w = 0; w < workers; w++)
+    {
+      threads.emplace_back([this, handler]() mutable
+      {
+        for (;;)
+        {
+          std::uint32_t a;
+          if (runnable.pop(a))
+          {
+            run(a, handler);
+            continue;
+          }
+          idle.wait([&]() { return stopped.load(std::memory_order_acquire) or not runnable_empty(); });
+          if (stopped.load(std::memory_order_acquire) and runnable_empty()) return;
+        }
+      });
+    }
+  }
+
+  // Constructs a U in the mailbox of the given actor. Returns false if the
+  // mailbox is full. Any thread may send.
+  template<typename U, typename... Args>
+  bool send(std::size_t actor, Args&&... args)
+  {
+    mailbox& mb = mailboxes[actor];
+    std::uint64_t pos = mb.tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      slot& s = mb.slots[pos % M];
+      std::uint64_t seq = s.seq.load(std::memory_order_acquire);
+      if (seq == pos)
+      {
+        if (mb.tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          s.value.template emplace_small<U>(std::forward<Args>(args)...);
+          s.seq.store(pos + 1, std::memory_order_release);
+          break;
+        }
+      }
+      else if (seq < pos)
+        return false;
+      else
+        pos = mb.tail.load(std::memory_order_relaxed);
+    }
+    schedule(actor);
+    return true;
+  }
+
+  // Lets the workers handle all messages sent so far, then joins them.
+  void stop()
+  {
+    stopped.store(true, std::memory_order_release);
+    idle.wake_all();
+    for (auto& t : threads)
+      t.join();
+    threads.clear();
+  }
+
+private:
+  struct slot
+  {
+    std::atomic<std::uint64_t> seq;
+    value_type value;
+  };
+
+  struct alignas(64) mailbox
+  {
+    mailbox()
+    {
+      for (std::size_t i = 0; i < M; i++)
+        slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> scheduled{false};
+    std::atomic<std::uint64_t> tail{0};
+    std::uint64_t head = 0;
+    slot slots[M];
+  };
+
+  bool runnable_empty()
+  {
+    return pending.load(std::memory_order_acquire) == 0;
+  }
+
+  void schedule(std::size_t actor)
+  {
+    if (mailboxes[actor].scheduled.exchange(true, std::memory_order_seq_cst)) return;
+    pending.fetch_add(1, std::memory_order_release);
+    runnable.push(std::uint32_t(actor));
+    idle.notify();
+  }
+
+  bool has_message(mailbox& mb)
+  {
+    return mb.slots[mb.head % M].seq.load(std::memory_order_acquire) == mb.head + 1;
+  }
+
+  template<typename F>
+  void run(std::uint32_t actor, F& handler)
+  {
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    mailbox& mb = mailboxes[actor];
+    for (std::size_t i = 0; i < Batch and has_message(mb); i++)
+    {
+      slot& s = mb.slots[mb.head % M];
+      handler(std::size_t(actor), s.value);
+      s.value.reset();
+      s.seq.store(mb.head + M, std::memory_order_release);
+      mb.head++;
+    }
+    mb.scheduled.store(false, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (has_message(mb)) schedule(actor);
+  }
+
+  std::unique_ptr<mailbox[]> mailboxes;
+  actor_run_queue runnable;
+  std::size_t workers;
+  std::atomic<std::size_t> pending{0};
+  std::atomic<bool> stopped{false};
+  futex_wait<> idle;
+  std::vector<std::thread> threads;
+};
+
+#endif /* TEST_ACTOR_H_ */
@@ -0,0 +1,98 @@
+#ifndef TEST_COALESCING_FIFO_H_
+#define TEST_COALESCING_FIFO_H_
+
+#include "ddw/impl.hpp"
+#include "fifo.h"
+#include <type_traits>
+#include <utility>
+
+template<typename U, typename = void>
+struct has_merge : std::false_type {};
+
+template<typename U>
+struct has_merge<U, std::void_t<decltype(std::declval<U&>().merge(std::declval<U&&>()))>> : std::true_type {};
+
+// SPSC fifo of ddw::impl<T, C, A> that coalesces bursts. Implementation types
+// opt in by providing merge(U&&): pushing such a U while the most recent
+// slot is not yet published and holds a U merges it into that slot instead
+// of taking a new one. Each slot carries the address of a per-type tag, so
+// the type check is a single pointer comparison. Lvalues are stored by
+// reference, so they are pushed untagged: they are never merged, nor merged
+// into, which would modify the caller's object.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*),
+    std::size_t N = 65536, std::size_t B = 256>
+struct coalescing_fifo
+{
+  using value_type = ddw::impl<T, C, A>;
+
+  struct slot
+  {
+    template<typename... Args>
+    slot(const void* type, Args&&... args) : type(type), value(std::forward<Args>(args)...) {}
+
+    const void* type;
+    value_type value;
+  };
+
+  bool full() const
+  {
+    return q.full();
+  }
+
+  // Returns false if v was merged into the previous message.
+  template<typename U>
+  bool push(U&& v)
+  {
+    using impl_type = std::remove_const_t<std::remove_reference_t<U>>;
+    if constexpr (has_merge<impl_type>::value and not std::is_lvalue_reference_v<U>)
+    {
+      if (q.new_tail != q.tail)
+      {
+        slot& last = *reinterpret_cast<slot*>(&q.data[(q.new_tail + N - 1) % N]);
+        if (last.type == &tag<impl_type>)
+        {
+          static_cast<impl_type&>(*last.value).merge(std::forward<U>(v));
+          return false;
+        }
+      }
+      q.push(&tag<impl_type>, std::forward<U>(v));
+    }
+    else
+      q.push(nullptr, std::forward<U>(v));
+    return true;
+  }
+
+  void flush()
+  {
+    q.flush();
+  }
+
+  bool empty() const
+  {
+    return q.empty();
+  }
+
+  value_type& front()
+  {
+    return q.front().value;
+  }
+
+  void pop()
+  {
+    q.pop();
+  }
+
+  template<typename F>
+  std::size_t drain(std::size_t max, F&& handler)
+  {
+    return q.drain(max, [&](slot& s) { handler(s.value); });
+  }
+
+private:
+  template<typename U>
+  static inline const char tag = 0;
+
+  fifo<slot, N, B> q;
+};
+
+#endif /* TEST_COALESCING_FIFO_H_ */
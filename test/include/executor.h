@@ -0,0 +1,114 @@
+#ifndef TEST_EXECUTOR_H_
+#define TEST_EXECUTOR_H_
+
+#include "ddw/impl.hpp"
+#include "fifo.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+inline bool pin_to_cpu(pthread_t thread, int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+// Sharded executor of ddw::impl<T, C, A> tasks. Every worker thread is pinned
+// to its own cpu and owns one fifo per producer, so no cache line is written
+// by more than one producer and one consumer. Workers round-robin over their
+// lanes and handle each lane in batches of at most `batch` tasks.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*),
+    std::size_t N = 4096, std::size_t B = 64>
+struct sharded_executor
+{
+  using value_type = ddw::impl<T, C, A>;
+  using lane = fifo<value_type, N, B>;
+  static const std::size_t batch = 256;
+
+  sharded_executor(std::size_t producers, std::vector<int> cpus) : cpus(std::move(cpus))
+  {
+    lanes.resize(this->cpus.size());
+    for (auto& worker_lanes : lanes)
+      for (std::size_t p = 0; p < producers; p++)
+        worker_lanes.push_back(std::make_unique<lane>());
+  }
+
+  sharded_executor(const sharded_executor&) = delete;
+
+  ~sharded_executor()
+  {
+    stop();
+  }
+
+  std::size_t workers() const
+  {
+    return cpus.size();
+  }
+
+  // Starts the workers; handler(value_type&) is called for every task.
+  template<typename F>
+  void start(F handler)
+  {
+    for (std::size_t w = 0; w < cpus.size(); w++)
+    {
+      threads.emplace_back([this, w, handler]() mutable
+      {
+        auto& worker_lanes = lanes[w];
+        for (;;)
+        {
+          bool stopping = stopped.load(std::memory_order_acquire);
+          std::size_t handled = 0;
+          for (auto& l : worker_lanes)
+            handled += l->drain(batch, handler);
+          if (handled == 0)
+          {
+            if (stopping) return;
+            std::this_thread::yield();
+          }
+        }
+      });
+      pin_to_cpu(threads.back().native_handle(), cpus[w]);
+    }
+  }
+
+  // Must only be called by the thread that acts as the given producer.
+  template<typename U>
+  void post(std::size_t producer, std::size_t worker, U&& v)
+  {
+    lane& l = *lanes[worker][producer];
+    while (l.full())
+    {
+      l.flush();
+      std::this_thread::yield();
+    }
+    l.push(std::forward<U>(v));
+  }
+
+  void flush(std::size_t producer)
+  {
+    for (auto& worker_lanes : lanes)
+      worker_lanes[producer]->flush();
+  }
+
+  // Handles all flushed tasks, then joins the workers.
+  void stop()
+  {
+    stopped.store(true, std::memory_order_release);
+    for (auto& t : threads)
+      t.join();
+    threads.clear();
+  }
+
+private:
+  std::vector<int> cpus;
+  std::vector<std::vector<std::unique_ptr<lane>>> lanes;
+  std::vector<std::thread> threads;
+  std::atomic<bool> stopped{false};
+};
+
+#endif /* TEST_EXECUTOR_H_ */
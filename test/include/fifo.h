@@ -5,10 +5,28 @@
 #include <utility>
 #include <cstdint>
 #include <type_traits>
+#include <algorithm>
+
+template<typename T, typename = void>
+struct fifo_prefetcher
+{
+  static void target(const T&) {}
+};
+
+template<typename T>
+struct fifo_prefetcher<T, std::void_t<decltype(std::declval<const T&>().get())>>
+{
+  static void target(const T& v)
+  {
+    __builtin_prefetch(v.get());
+  }
+};
 
 template<typename T, std::size_t N = 65536, std::size_t B = 256>
 struct fifo
 {
+  static const std::size_t prefetch_distance = 8;
+
   typename std::aligned_storage<sizeof(T), alignof(T)>::type data[N];
   uint8_t padding1[64];
   std::size_t head = 0;
@@ -33,6 +51,18 @@ struct fifo
     if (taildiff >= B) flush();
   }
 
+  // Constructs a U in place in the slot of a T (such as ddw::impl) that has
+  // emplace<U>(args...), so U itself is never moved or copied.
+  template<typename U, typename... Args>
+  void emplace(Args&&... args)
+  {
+    new (&data[new_tail]) T();
+    reinterpret_cast<T*>(&data[new_tail])->template emplace<U>(std::forward<Args>(args)...);
+    new_tail = (new_tail + 1) % N;
+    std::size_t taildiff = (N + new_tail - tail) % N;
+    if (taildiff >= B) flush();
+  }
+
   void flush()
   {
     atomic_thread_fence(std::memory_order_release);
@@ -61,6 +91,34 @@ struct fifo
       head = new_head;
     }
   }
+
+  // Handles and pops up to max elements after a single acquire. While one
+  // element is handled, the slots further down the batch and the objects
+  // they point to (e.g. heap-allocated impls) are prefetched.
+  template<typename F>
+  std::size_t drain(std::size_t max, F&& handler)
+  {
+    std::size_t published = tail;
+    atomic_thread_fence(std::memory_order_acquire);
+    std::size_t n = std::min(max, (N + published - new_head) % N);
+    for (std::size_t i = 0; i < n; i++)
+    {
+      if (i + prefetch_distance < n)
+        __builtin_prefetch(&data[(new_head + i + prefetch_distance) % N]);
+      if (i + prefetch_distance / 2 < n)
+        fifo_prefetcher<T>::target(*reinterpret_cast<T*>(&data[(new_head + i + prefetch_distance / 2) % N]));
+      T& v = *reinterpret_cast<T*>(&data[(new_head + i) % N]);
+      handler(v);
+      v.~T();
+    }
+    new_head = (new_head + n) % N;
+    std::size_t headdiff = (N + new_head - head) % N;
+    if (headdiff >= B)
+    {
+      head = new_head;
+    }
+    return n;
+  }
 };
 
 
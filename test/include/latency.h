@@ -0,0 +1,171 @@
+#ifndef TEST_LATENCY_H_
+#define TEST_LATENCY_H_
+
+#include "ddw/impl.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef DDW_LATENCY_TRACING
+#define DDW_LATENCY_TRACING 0
+#endif
+
+inline constexpr bool latency_tracing = DDW_LATENCY_TRACING;
+
+// Time stamps for tracing: the TSC on x86, calibrated once against
+// steady_clock, and steady_clock nanoseconds elsewhere.
+struct latency_clock
+{
+  static std::uint64_t now()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  static std::chrono::nanoseconds since(std::uint64_t then)
+  {
+    static const double ns_per_tick = calibrate();
+    std::uint64_t t = now();
+    return std::chrono::nanoseconds(t > then ? std::int64_t((t - then) * ns_per_tick) : 0);
+  }
+
+private:
+  static double calibrate()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    auto t0 = std::chrono::steady_clock::now();
+    std::uint64_t c0 = now();
+    while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(1)) {}
+    auto t1 = std::chrono::steady_clock::now();
+    std::uint64_t c1 = now();
+    return std::chrono::nanoseconds(t1 - t0).count() / double(c1 - c0);
+#else
+    return 1.0;
+#endif
+  }
+};
+
+// Histogram of queue residence times with power-of-two nanosecond buckets.
+// Every thread records into its own instance with plain relaxed stores, so
+// recording is wait-free; scrape() sums all instances ever created and may
+// run concurrently with recording.
+struct latency_histogram
+{
+  static const std::size_t buckets = 64;
+
+  void record(std::chrono::nanoseconds ns)
+  {
+    std::uint64_t v = ns.count() > 0 ? ns.count() : 1;
+    auto& b = counts[63 - __builtin_clzll(v)];
+    b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static latency_histogram& local()
+  {
+    thread_local latency_histogram* h = registry().add();
+    return *h;
+  }
+
+  // Returns the number of samples per bucket; bucket i holds [2^i, 2^(i+1)) ns.
+  static std::array<std::uint64_t, buckets> scrape()
+  {
+    std::array<std::uint64_t, buckets> sum{};
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& h : r.histograms)
+      for (std::size_t i = 0; i < buckets; i++)
+        sum[i] += h->counts[i].load(std::memory_order_relaxed);
+    return sum;
+  }
+
+  // Returns the upper bound in ns of the bucket holding the given quantile.
+  static std::uint64_t quantile(const std::array<std::uint64_t, buckets>& counts, double q)
+  {
+    std::uint64_t total = 0;
+    for (auto c : counts)
+      total += c;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets; i++)
+    {
+      seen += counts[i];
+      if (seen > 0 and seen >= q * total) return std::uint64_t(2) << i;
+    }
+    return 0;
+  }
+
+private:
+  struct registry_type
+  {
+    latency_histogram* add()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      histograms.push_back(std::make_unique<latency_histogram>());
+      return histograms.back().get();
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<latency_histogram>> histograms;
+  };
+
+  static registry_type& registry()
+  {
+    static registry_type r;
+    return r;
+  }
+
+  std::atomic<std::uint64_t> counts[buckets] = {};
+};
+
+// Queue element holding a ddw::impl<T, C, A> and, if Traced, the latency_clock
+// time at which it was constructed into the queue. The consumer calls record()
+// to add the time since then to its thread's latency_histogram. Without
+// tracing the envelope is exactly an impl and record() is a no-op.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*), bool Traced = latency_tracing>
+struct stamped
+{
+  using value_type = ddw::impl<T, C, A>;
+
+  template<typename... Args>
+  stamped(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+  T& operator*() { return *value; }
+  T* operator->() { return value.get(); }
+
+  void record() {}
+
+  value_type value;
+};
+
+template<typename T, std::size_t C, std::size_t A>
+struct stamped<T, C, A, true>
+{
+  using value_type = ddw::impl<T, C, A>;
+
+  template<typename... Args>
+  stamped(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+  T& operator*() { return *value; }
+  T* operator->() { return value.get(); }
+
+  void record()
+  {
+    latency_histogram::local().record(latency_clock::since(pushed));
+  }
+
+  value_type value;
+  std::uint64_t pushed = latency_clock::now();
+};
+
+#endif /* TEST_LATENCY_H_ */
@@ -0,0 +1,132 @@
+#ifndef TEST_PERF_COUNTERS_H_
+#define TEST_PERF_COUNTERS_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware performance counters of the calling process, opened through
+// perf_event_open(). Counting is inherited by threads created after start(),
+// so all threads of a benchmark scenario are covered. Counters are only opened
+// when the DDW_PERF_COUNTERS environment variable is set; counters that are
+// not available (no PMU, perf_event_paranoid, ...) are silently left out.
+// There are more events than most PMUs count at once, so the kernel
+// multiplexes them; every value is scaled by the time its event was enabled
+// over the time it was actually counting, and marked with '~' when it was.
+struct perf_counters
+{
+  struct counter
+  {
+    const char* name;
+    std::uint32_t type;
+    std::uint64_t config;
+    int fd;
+    double value;
+    bool scaled;
+  };
+
+  static std::uint64_t cache_event(std::uint64_t cache, std::uint64_t op, std::uint64_t result)
+  {
+    return cache | (op << 8) | (result << 16);
+  }
+
+  counter counters[7] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1, 0, false},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1, 0, false},
+    {"L1d-misses", PERF_TYPE_HW_CACHE,
+        cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), -1, 0, false},
+    {"LLC-misses", PERF_TYPE_HW_CACHE,
+        cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), -1, 0, false},
+    {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1, 0, false},
+    {"dTLB-misses", PERF_TYPE_HW_CACHE,
+        cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), -1, 0, false},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, -1, 0, false},
+  };
+
+  perf_counters()
+  {
+    if (not std::getenv("DDW_PERF_COUNTERS")) return;
+    for (auto& c : counters)
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = c.type;
+      attr.config = c.config;
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      c.fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+  }
+
+  perf_counters(const perf_counters&) = delete;
+
+  ~perf_counters()
+  {
+    for (auto& c : counters)
+      if (c.fd >= 0) close(c.fd);
+  }
+
+  bool available() const
+  {
+    for (auto& c : counters)
+      if (c.fd >= 0) return true;
+    return false;
+  }
+
+  void start()
+  {
+    for (auto& c : counters)
+    {
+      if (c.fd < 0) continue;
+      ioctl(c.fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(c.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  void stop()
+  {
+    for (auto& c : counters)
+    {
+      if (c.fd < 0) continue;
+      ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+      // value, time enabled, time running
+      std::uint64_t r[3];
+      c.value = 0;
+      c.scaled = false;
+      if (read(c.fd, r, sizeof(r)) != sizeof(r) or r[2] == 0) continue;
+      c.value = double(r[0]);
+      if (r[2] < r[1])
+      {
+        c.value *= double(r[1]) / r[2];
+        c.scaled = true;
+      }
+    }
+  }
+
+  // Prints every available counter divided by the number of messages.
+  void report(std::ostream& os, std::uint64_t messages) const
+  {
+    if (not available() or messages == 0) return;
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os << "  per message:" << std::fixed << std::setprecision(2);
+    for (auto& c : counters)
+      if (c.fd >= 0)
+        os << ' ' << c.name << '=' << (c.scaled ? "~" : "") << c.value / messages;
+    os << '\n';
+    os.flags(flags);
+    os.precision(precision);
+  }
+};
+
+#endif /* TEST_PERF_COUNTERS_H_ */
@@ -0,0 +1,94 @@
+#ifndef TEST_PIPELINE_H_
+#define TEST_PIPELINE_H_
+
+#include "ddw/impl.hpp"
+#include "fifo.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Multi-stage pipeline in which messages never move. Each message is
+// constructed once, in place, in a slot of a shared slab of ddw::impl<T, C, A>;
+// only slot indices travel through the SPSC rings between the stages. The last
+// stage destroys the message and hands the slot back to the producer through
+// a dedicated ring.
+//
+// There is one producer thread and one thread per stage: stage s may only be
+// processed by a single thread at a time.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*),
+    std::size_t Slots = 4096, std::size_t B = 32>
+struct pipeline
+{
+  using value_type = ddw::impl<T, C, A>;
+  using index_ring = fifo<std::uint32_t, Slots + B, B>;
+
+  explicit pipeline(std::size_t stages) : slab(std::make_unique<value_type[]>(Slots))
+  {
+    for (std::size_t s = 0; s < stages + 1; s++)
+      rings.push_back(std::make_unique<index_ring>());
+  }
+
+  pipeline(const pipeline&) = delete;
+
+  std::size_t stages() const
+  {
+    return rings.size() - 1;
+  }
+
+  bool full() const
+  {
+    return fresh == Slots and free_ring().empty();
+  }
+
+  // Constructs a U into a free slot and passes it to the first stage.
+  // Must only be called by the producer and not while full().
+  template<typename U, typename... Args>
+  void emplace(Args&&... args)
+  {
+    std::uint32_t i;
+    if (fresh < Slots)
+      i = fresh++;
+    else
+    {
+      i = free_ring().front();
+      free_ring().pop();
+    }
+    slab[i].template emplace<U>(std::forward<Args>(args)...);
+    rings[0]->push(i);
+  }
+
+  // Makes all messages emplaced so far visible to the first stage.
+  void flush()
+  {
+    rings[0]->flush();
+  }
+
+  // Hands up to max pending messages of the given stage to handler(value_type&)
+  // and passes them on to the next stage, or releases them after the last.
+  template<typename F>
+  std::size_t process(std::size_t stage, F&& handler, std::size_t max = 256)
+  {
+    index_ring& out = *rings[stage + 1];
+    bool last = stage + 1 == stages();
+    std::size_t n = rings[stage]->drain(max, [&](std::uint32_t i)
+    {
+      handler(slab[i]);
+      if (last) slab[i].reset();
+      out.push(i);
+    });
+    if (n) out.flush();
+    return n;
+  }
+
+private:
+  index_ring& free_ring() const
+  {
+    return *rings.back();
+  }
+
+  std::unique_ptr<value_type[]> slab;
+  std::vector<std::unique_ptr<index_ring>> rings;
+  std::uint32_t fresh = 0;
+};
+
+#endif /* TEST_PIPELINE_H_ */
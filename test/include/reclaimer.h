@@ -0,0 +1,101 @@
+#ifndef TEST_RECLAIMER_H_
+#define TEST_RECLAIMER_H_
+
+#include "ddw/impl.hpp"
+#include "fifo.h"
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Default policy of retire_list: an implementation is expensive to destroy if
+// the interface has a `bool expensive_destructor() const` that says so.
+// Without such a member, everything is destroyed inline.
+template<typename T, typename = void>
+struct retire_if_expensive
+{
+  bool operator()(const T&) const { return false; }
+};
+
+template<typename T>
+struct retire_if_expensive<T, std::void_t<decltype(std::declval<const T&>().expensive_destructor())>>
+{
+  bool operator()(const T& v) const { return v.expensive_destructor(); }
+};
+
+// Per-thread list of finished ddw::impl<T, C, A> objects whose destruction is
+// deferred. retire() moves expensive implementations (as decided by Expensive)
+// out of the caller's impl and leaves the caller with a null impl, so the
+// subsequent fifo::pop() is cheap; everything else is left for inline
+// destruction. Retired objects are destroyed in batches by collect(), either
+// from the owning thread when it is idle or from a background_reclaimer, but
+// not both. If the list is full, retire() falls back to inline destruction.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*),
+    std::size_t N = 4096, std::size_t B = 64, typename Expensive = retire_if_expensive<T>>
+struct retire_list
+{
+  using value_type = ddw::impl<T, C, A>;
+
+  void retire(value_type& v)
+  {
+    if (not v or not Expensive()(*v) or retired.full()) return;
+    retired.push(std::move(v));
+    v.reset();
+  }
+
+  // Publishes objects retired since the last batch to the collecting thread.
+  void flush()
+  {
+    retired.flush();
+  }
+
+  // Destroys up to max retired objects and returns how many.
+  std::size_t collect(std::size_t max = B)
+  {
+    return retired.drain(max, [](value_type&) {});
+  }
+
+private:
+  fifo<value_type, N, B> retired;
+};
+
+// Thread that collects a fixed set of retire lists until it is destroyed.
+template<typename List>
+struct background_reclaimer
+{
+  explicit background_reclaimer(std::vector<List*> lists) : lists(std::move(lists))
+  {
+    thread = std::thread([this]()
+    {
+      for (;;)
+      {
+        bool stopping = stopped.load(std::memory_order_acquire);
+        std::size_t collected = 0;
+        for (auto l : this->lists)
+          collected += l->collect();
+        if (collected == 0)
+        {
+          if (stopping) return;
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  background_reclaimer(const background_reclaimer&) = delete;
+
+  // Flush the lists before destruction to have everything collected.
+  ~background_reclaimer()
+  {
+    stopped.store(true, std::memory_order_release);
+    thread.join();
+  }
+
+private:
+  std::vector<List*> lists;
+  std::atomic<bool> stopped{false};
+  std::thread thread;
+};
+
+#endif /* TEST_RECLAIMER_H_ */
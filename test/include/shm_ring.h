@@ -0,0 +1,200 @@
+#ifndef TEST_SHM_RING_H_
+#define TEST_SHM_RING_H_
+
+#include "ddw/impl.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Bounded multi-producer single-consumer ring of T implementations in POSIX
+// shared memory, usable across processes.
+//
+// Messages are constructed in place in a slot by the producer and read in
+// place by the consumer, so they must be trivially relocatable and must not
+// contain pointers: every stored type has to be opted in through
+// ddw::impl_trivially_movable and registered under the same id (below
+// max_types) in every process. Since the vptr written by the producer is only
+// valid in the producer process, the consumer overwrites it with its own vptr
+// for the registered type before handing out a T& or destroying the message;
+// messages of a type this process did not register are rejected.
+// Registration learns that vptr from an instance of exactly U supplied by the
+// caller. Type ids are registered per ring instance. This assumes the Itanium
+// C++ ABI and single inheritance: one vptr, at offset 0.
+template<typename T, std::size_t SlotSize = 64, std::size_t N = 4096>
+struct shm_ring
+{
+  static const std::size_t max_types = 64;
+
+  struct slot
+  {
+    std::atomic<std::uint64_t> seq;
+    std::uint32_t type;
+    alignas(std::max_align_t) unsigned char value[SlotSize];
+  };
+
+  struct shared
+  {
+    std::atomic<std::uint64_t> tail;
+    alignas(64) std::uint64_t head;
+    alignas(64) std::atomic<std::uint32_t> type_sizes[max_types];
+    slot slots[N];
+  };
+
+  // Creates the ring if create is set, otherwise opens an existing one.
+  shm_ring(const std::string& name, bool create) : name(name), owner(create)
+  {
+    int fd = ::shm_open(name.c_str(), O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0600);
+    if (fd < 0)
+      throw std::system_error(errno, std::system_category(), "shm_ring: shm_open " + name);
+    if (create and ::ftruncate(fd, sizeof(shared)) != 0)
+    {
+      ::close(fd);
+      throw std::system_error(errno, std::system_category(), "shm_ring: ftruncate " + name);
+    }
+    void* p = ::mmap(nullptr, sizeof(shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+      throw std::system_error(errno, std::system_category(), "shm_ring: mmap " + name);
+    s = static_cast<shared*>(p);
+    if (create)
+    {
+      s->tail = 0;
+      s->head = 0;
+      for (auto& t : s->type_sizes)
+        t = 0;
+      for (std::size_t i = 0; i < N; i++)
+        new (&s->slots[i].seq) std::atomic<std::uint64_t>(i);
+    }
+  }
+
+  shm_ring(const shm_ring&) = delete;
+
+  ~shm_ring()
+  {
+    ::munmap(s, sizeof(shared));
+    if (owner) ::shm_unlink(name.c_str());
+  }
+
+  // Registers U under id, taking the vptr from instance, whose dynamic type
+  // must be U itself.
+  template<typename U>
+  void register_type(std::uint32_t id, const U& instance)
+  {
+    static_assert(std::is_base_of_v<T, U>, "T is not a base of U");
+    static_assert(ddw::impl_trivially_movable<U>::value, "U is not trivially movable");
+    static_assert(sizeof(U) <= SlotSize, "capacity too small to store U");
+    static_assert(alignof(U) <= alignof(std::max_align_t), "alignment too small to store U");
+    if (id >= max_types)
+      throw std::invalid_argument("shm_ring: type id out of range");
+    std::uint32_t expected = 0;
+    if (not s->type_sizes[id].compare_exchange_strong(expected, sizeof(U)) and expected != sizeof(U))
+      throw std::runtime_error("shm_ring: type " + std::to_string(id) + " registered with another size");
+    if (static_cast<const void*>(static_cast<const T*>(&instance)) != static_cast<const void*>(&instance))
+      throw std::logic_error("shm_ring: T must be the primary base of U");
+    std::memcpy(&types[id], &instance, sizeof(void*));
+    std::size_t index = type_index<U>();
+    if (ids.size() <= index)
+      ids.resize(index + 1, max_types);
+    ids[index] = id;
+  }
+
+  // Returns false if the ring is full. U must have been registered.
+  template<typename U, typename... Args>
+  bool try_emplace(Args&&... args)
+  {
+    std::uint32_t id = id_of<U>();
+    if (id == max_types)
+      throw std::logic_error("shm_ring: type not registered");
+    std::uint64_t pos = s->tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      slot& sl = s->slots[pos % N];
+      std::uint64_t seq = sl.seq.load(std::memory_order_acquire);
+      if (seq == pos)
+      {
+        if (s->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          sl.type = id;
+          new (sl.value) U(std::forward<Args>(args)...);
+          sl.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (seq < pos)
+        return false;
+      else
+        pos = s->tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  bool empty() const
+  {
+    return s->slots[s->head % N].seq.load(std::memory_order_acquire) != s->head + 1;
+  }
+
+  // Only valid if not empty(). Throws std::runtime_error if the message is of
+  // a type that this process did not register.
+  T& front()
+  {
+    return local(s->slots[s->head % N]);
+  }
+
+  // Only valid if not empty(). Throws like front(), leaving the message in
+  // place.
+  void pop()
+  {
+    slot& sl = s->slots[s->head % N];
+    local(sl).~T();
+    sl.seq.store(s->head + N, std::memory_order_release);
+    s->head++;
+  }
+
+private:
+  // Installs the vptr of this process into the message in sl.
+  T& local(slot& sl)
+  {
+    std::uint32_t type = sl.type;
+    if (type >= max_types or types[type] == nullptr)
+      throw std::runtime_error("shm_ring: unregistered type id " + std::to_string(type));
+    std::memcpy(sl.value, &types[type], sizeof(void*));
+    return *reinterpret_cast<T*>(sl.value);
+  }
+
+  // Process-wide dense index of U, used to look up its id in this ring.
+  template<typename U>
+  static std::size_t type_index()
+  {
+    static const std::size_t index = next_type_index()++;
+    return index;
+  }
+
+  static std::atomic<std::size_t>& next_type_index()
+  {
+    static std::atomic<std::size_t> next{0};
+    return next;
+  }
+
+  template<typename U>
+  std::uint32_t id_of() const
+  {
+    std::size_t index = type_index<U>();
+    return index < ids.size() ? ids[index] : max_types;
+  }
+
+  std::string name;
+  bool owner;
+  shared* s;
+  const void* types[max_types] = {};
+  std::vector<std::uint32_t> ids;
+};
+
+#endif /* TEST_SHM_RING_H_ */
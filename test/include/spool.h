@@ -0,0 +1,285 @@
+#ifndef TEST_SPOOL_H_
+#define TEST_SPOOL_H_
+
+#include "ddw/impl.hpp"
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Persistent FIFO of ddw::impl<T, C, A> records in a memory-mapped file.
+//
+// Every stored type registers a stable id, a save function and a load
+// function. save(v, dst, capacity) serializes v straight into the mapping,
+// writing at most capacity (R) bytes, and returns the size of the record; a
+// size above capacity means that it did not fit, and the record is rejected.
+// load() reconstructs the object into an impl, typically through
+// impl::emplace<U>(). Records written by push() only become durable at commit
+// points: every B records, or on flush(). Records handled by replay() are only
+// released every B records, so after a crash they are delivered at least once.
+// Failures to make data durable throw std::system_error, except from the
+// destructor, so call flush() and release() before it to see them.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*),
+    std::size_t R = 256, std::size_t B = 256>
+struct spool
+{
+  using value_type = ddw::impl<T, C, A>;
+  using load_fn = void (*)(const char* src, std::size_t n, value_type& dst);
+  static const std::size_t max_record = R;
+
+  struct header
+  {
+    std::uint64_t magic;
+    std::uint64_t size;
+    std::atomic<std::uint64_t> head;
+    std::atomic<std::uint64_t> tail;
+  };
+
+  struct record
+  {
+    std::uint32_t length;
+    std::uint32_t type;
+  };
+
+  static const std::uint64_t spool_magic = 0x6464772d73706f6fULL;
+  static const std::uint32_t pad_type = 0;
+
+  template<typename U>
+  using save_fn = std::size_t (*)(const U&, char* dst, std::size_t capacity);
+
+  template<typename U>
+  static void register_type(std::uint32_t id, save_fn<U> save, load_fn load)
+  {
+    if (id == pad_type)
+      throw std::invalid_argument("spool: type id 0 is reserved");
+    saver<U>() = {id, save};
+    loaders()[id] = load;
+  }
+
+  spool(const std::string& path, std::size_t size) : header_size(::sysconf(_SC_PAGESIZE))
+  {
+    size = align(size);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+      throw std::system_error(errno, std::system_category(), "spool: open " + path);
+    auto fail = [&](const char* what)
+    {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::system_category(), std::string("spool: ") + what + " " + path);
+    };
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+      fail("fstat");
+    bool fresh = std::size_t(st.st_size) < header_size;
+    if (fresh and ::ftruncate(fd, header_size + size) != 0)
+      fail("ftruncate");
+    if (not fresh)
+      size = st.st_size - header_size;
+    void* p = ::mmap(nullptr, header_size + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+      fail("mmap");
+    base = static_cast<char*>(p);
+    hdr = reinterpret_cast<header*>(base);
+    data = base + header_size;
+    if (fresh or hdr->magic != spool_magic or hdr->size != size)
+    {
+      hdr->size = size;
+      hdr->head = 0;
+      hdr->tail = 0;
+      hdr->magic = spool_magic;
+      if (::msync(base, header_size, MS_SYNC) != 0)
+      {
+        ::munmap(base, header_size + size);
+        fail("msync");
+      }
+    }
+    new_head = hdr->head;
+    new_tail = hdr->tail;
+  }
+
+  spool(const spool&) = delete;
+  spool& operator=(const spool&) = delete;
+
+  ~spool()
+  {
+    try
+    {
+      flush();
+      release();
+    }
+    catch (const std::system_error&)
+    {
+    }
+    ::munmap(base, header_size + hdr->size);
+    ::close(fd);
+  }
+
+  bool full() const
+  {
+    return new_tail + 2 * (sizeof(record) + R) > hdr->head.load(std::memory_order_acquire) + hdr->size;
+  }
+
+  // Appends v. Throws std::length_error if the spool is full, rather than
+  // overwriting records that were not released yet, and std::logic_error if
+  // the record needs more than R bytes; it is not kept in either case.
+  template<typename U>
+  void push(const U& v)
+  {
+    const auto& s = saver<U>();
+    if (s.save == nullptr)
+      throw std::logic_error("spool: type not registered");
+    if (full())
+      throw std::length_error("spool: full");
+    std::size_t offset = new_tail % hdr->size;
+    if (offset + sizeof(record) + R > hdr->size)
+    {
+      at(offset)->type = pad_type;
+      new_tail += hdr->size - offset;
+      offset = 0;
+    }
+    record* r = at(offset);
+    std::size_t n = s.save(v, reinterpret_cast<char*>(r + 1), R);
+    if (n > R)
+      throw std::logic_error("spool: record larger than R bytes");
+    r->length = n;
+    r->type = s.id;
+    new_tail += sizeof(record) + align(n);
+    if (++pushed >= B) flush();
+  }
+
+  // Makes all pushed records durable, then publishes them.
+  void flush()
+  {
+    std::uint64_t tail = hdr->tail.load(std::memory_order_relaxed);
+    if (tail == new_tail) return;
+    sync_data(tail, new_tail);
+    hdr->tail.store(new_tail, std::memory_order_release);
+    sync(base, header_size);
+    pushed = 0;
+  }
+
+  bool empty() const
+  {
+    return new_head == hdr->tail.load(std::memory_order_acquire);
+  }
+
+  // Hands every published record to f as a value_type&, in push order, and
+  // returns the number of records handled.
+  template<typename F>
+  std::size_t replay(F&& f)
+  {
+    std::size_t count = 0;
+    std::uint64_t tail = hdr->tail.load(std::memory_order_acquire);
+    while (new_head != tail)
+    {
+      std::size_t offset = new_head % hdr->size;
+      const record* r = at(offset);
+      if (r->type == pad_type)
+      {
+        new_head += hdr->size - offset;
+        continue;
+      }
+      auto it = loaders().find(r->type);
+      if (it == loaders().end())
+        throw std::runtime_error("spool: unregistered type id " + std::to_string(r->type));
+      {
+        value_type v;
+        it->second(reinterpret_cast<const char*>(r + 1), r->length, v);
+        f(v);
+      }
+      new_head += sizeof(record) + align(r->length);
+      count++;
+      if (++popped >= B) release();
+    }
+    return count;
+  }
+
+  // Makes the space of all handled records available again.
+  void release()
+  {
+    if (hdr->head.load(std::memory_order_relaxed) == new_head) return;
+    hdr->head.store(new_head, std::memory_order_release);
+    sync(base, header_size);
+    popped = 0;
+  }
+
+private:
+  template<typename U>
+  struct saver_entry
+  {
+    std::uint32_t id;
+    save_fn<U> save;
+  };
+
+  template<typename U>
+  static saver_entry<U>& saver()
+  {
+    static saver_entry<U> s{pad_type, nullptr};
+    return s;
+  }
+
+  static std::unordered_map<std::uint32_t, load_fn>& loaders()
+  {
+    static std::unordered_map<std::uint32_t, load_fn> l;
+    return l;
+  }
+
+  static std::size_t align(std::size_t n)
+  {
+    return (n + 7) & ~std::size_t(7);
+  }
+
+  record* at(std::size_t offset) const
+  {
+    return reinterpret_cast<record*>(data + offset);
+  }
+
+  void sync_data(std::uint64_t from, std::uint64_t to)
+  {
+    std::size_t size = hdr->size;
+    if (to - from >= size)
+      return sync_range(0, size);
+    std::size_t b = from % size;
+    std::size_t e = to % size;
+    if (b < e)
+      sync_range(b, e);
+    else
+    {
+      sync_range(b, size);
+      sync_range(0, e);
+    }
+  }
+
+  void sync_range(std::size_t b, std::size_t e)
+  {
+    // data starts one page into the mapping, so page offsets are aligned.
+    std::size_t first = b / header_size * header_size;
+    sync(data + first, e - first);
+  }
+
+  static void sync(void* p, std::size_t n)
+  {
+    if (::msync(p, n, MS_SYNC) != 0)
+      throw std::system_error(errno, std::system_category(), "spool: msync");
+  }
+
+  // One page, so that the records start page-aligned.
+  const std::size_t header_size;
+  int fd = -1;
+  char* base = nullptr;
+  header* hdr = nullptr;
+  char* data = nullptr;
+  std::uint64_t new_head = 0;
+  std::uint64_t new_tail = 0;
+  std::size_t pushed = 0;
+  std::size_t popped = 0;
+};
+
+#endif /* TEST_SPOOL_H_ */
@@ -0,0 +1,228 @@
+#ifndef TEST_TIMER_WHEEL_H_
+#define TEST_TIMER_WHEEL_H_
+
+#include "ddw/impl.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Hierarchical timer wheel of delayed ddw::impl<T, C, A> tasks.
+// Timers live in a slab of fixed-size chunks that is never moved, and are
+// chained per bucket by index, so scheduling a task that fits the impl
+// capacity allocates nothing once the slab has grown to its working size.
+// Level l has 64 buckets of 64^l ticks each; a timer is cascaded down a level
+// whenever the wheel below it wraps.
+template<typename T, std::size_t C = 32, std::size_t A = sizeof(void*), std::size_t Levels = 4>
+struct timer_wheel
+{
+  using value_type = ddw::impl<T, C, A>;
+
+  struct handle
+  {
+    std::uint32_t index;
+    std::uint32_t generation;
+  };
+
+  static const unsigned bits = 6;
+  static const std::size_t slots = 1 << bits;
+  static const std::size_t chunk_size = 4096;
+
+  explicit timer_wheel(std::uint64_t now = 0) : now(now)
+  {
+    for (auto& h : heads)
+      h = nil;
+  }
+
+  timer_wheel(const timer_wheel&) = delete;
+
+  std::uint64_t current_tick() const
+  {
+    return now;
+  }
+
+  std::size_t size() const
+  {
+    return count;
+  }
+
+  // Schedules v to expire delay ticks from now, at least one tick later.
+  template<typename U>
+  handle schedule(std::uint64_t delay, U&& v)
+  {
+    std::uint32_t i = allocate();
+    node& n = at(i);
+    n.task = std::forward<U>(v);
+    n.expiry = now + (delay ? delay : 1);
+    link(i);
+    return {i, n.generation};
+  }
+
+  template<typename U, typename... Args>
+  handle schedule_emplace(std::uint64_t delay, Args&&... args)
+  {
+    std::uint32_t i = allocate();
+    node& n = at(i);
+    n.task.template emplace<U>(std::forward<Args>(args)...);
+    n.expiry = now + (delay ? delay : 1);
+    link(i);
+    return {i, n.generation};
+  }
+
+  // Returns false if the timer already expired or was cancelled before.
+  bool cancel(handle h)
+  {
+    if (h.index >= chunks.size() * chunk_size) return false;
+    node& n = at(h.index);
+    if (n.generation != h.generation or n.bucket == nil) return false;
+    unlink(h.index);
+    release(h.index);
+    return true;
+  }
+
+  // Advances the wheel by the given number of ticks. On every tick, all
+  // timers expiring on it are handed to handler(value_type&) as one batch.
+  // The handler may schedule and cancel timers. Returns the number of expired
+  // timers.
+  template<typename F>
+  std::size_t advance(std::uint64_t ticks, F&& handler)
+  {
+    std::size_t expired = 0;
+    for (std::uint64_t t = 0; t < ticks; t++)
+    {
+      now++;
+      if ((now & (slots - 1)) == 0)
+        cascade(1);
+      std::uint32_t due = now & (slots - 1);
+      if (heads[due] == nil) continue;
+      splice(due, expiring);
+      while (heads[expiring] != nil)
+      {
+        std::uint32_t i = heads[expiring];
+        unlink(i);
+        handler(at(i).task);
+        release(i);
+        expired++;
+      }
+    }
+    return expired;
+  }
+
+private:
+  static const std::uint32_t nil = ~std::uint32_t(0);
+  static const std::uint32_t expiring = Levels * slots;
+
+  struct node
+  {
+    value_type task;
+    std::uint64_t expiry = 0;
+    std::uint32_t prev = nil;
+    std::uint32_t next = nil;
+    std::uint32_t bucket = nil;
+    std::uint32_t generation = 0;
+  };
+
+  node& at(std::uint32_t i)
+  {
+    return chunks[i / chunk_size][i % chunk_size];
+  }
+
+  std::uint32_t allocate()
+  {
+    if (free_list == nil)
+      grow();
+    std::uint32_t i = free_list;
+    free_list = at(i).next;
+    count++;
+    return i;
+  }
+
+  DDW_IMPL_COLD void grow()
+  {
+    std::uint32_t first = chunks.size() * chunk_size;
+    chunks.push_back(std::make_unique<node[]>(chunk_size));
+    for (std::uint32_t i = chunk_size; i-- > 0;)
+    {
+      chunks.back()[i].next = free_list;
+      free_list = first + i;
+    }
+  }
+
+  void release(std::uint32_t i)
+  {
+    node& n = at(i);
+    n.task.reset();
+    n.generation++;
+    n.next = free_list;
+    free_list = i;
+    count--;
+  }
+
+  void link(std::uint32_t i)
+  {
+    node& n = at(i);
+    std::uint64_t delta = n.expiry - now;
+    std::uint64_t expiry = n.expiry;
+    unsigned level = 0;
+    while (level + 1 < Levels and delta >= (std::uint64_t(1) << (bits * (level + 1))))
+      level++;
+    if (delta >= (std::uint64_t(1) << (bits * Levels)))
+      expiry = now + (std::uint64_t(1) << (bits * Levels)) - 1;
+    push(level * slots + ((expiry >> (bits * level)) & (slots - 1)), i);
+  }
+
+  void push(std::uint32_t bucket, std::uint32_t i)
+  {
+    node& n = at(i);
+    n.bucket = bucket;
+    n.prev = nil;
+    n.next = heads[bucket];
+    if (n.next != nil)
+      at(n.next).prev = i;
+    heads[bucket] = i;
+  }
+
+  void unlink(std::uint32_t i)
+  {
+    node& n = at(i);
+    if (n.prev != nil)
+      at(n.prev).next = n.next;
+    else
+      heads[n.bucket] = n.next;
+    if (n.next != nil)
+      at(n.next).prev = n.prev;
+    n.bucket = nil;
+  }
+
+  void splice(std::uint32_t from, std::uint32_t to)
+  {
+    for (std::uint32_t i = heads[from]; i != nil; i = at(i).next)
+      at(i).bucket = to;
+    heads[to] = heads[from];
+    heads[from] = nil;
+  }
+
+  void cascade(unsigned level)
+  {
+    if (level >= Levels) return;
+    std::uint32_t slot = (now >> (bits * level)) & (slots - 1);
+    if (slot == 0)
+      cascade(level + 1);
+    std::uint32_t bucket = level * slots + slot;
+    std::uint32_t i = heads[bucket];
+    heads[bucket] = nil;
+    while (i != nil)
+    {
+      std::uint32_t next = at(i).next;
+      link(i);
+      i = next;
+    }
+  }
+
+  std::uint64_t now;
+  std::size_t count = 0;
+  std::uint32_t free_list = nil;
+  std::uint32_t heads[Levels * slots + 1];
+  std::vector<std::unique_ptr<node[]>> chunks;
+};
+
+#endif /* TEST_TIMER_WHEEL_H_ */
@@ -0,0 +1,123 @@
+#ifndef TEST_WAIT_STRATEGY_H_
+#define TEST_WAIT_STRATEGY_H_
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Wait strategies for the threads on either side of a queue. The waiting
+// side calls wait(ready) with a predicate such as [&] { return not q.empty(); },
+// the other side calls notify() after publishing (e.g. after fifo::flush()).
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// What the perftests used to do: poll with a short sleep.
+struct sleep_wait
+{
+  template<typename F>
+  void wait(F&& ready)
+  {
+    while (not ready())
+      std::this_thread::sleep_for(std::chrono::microseconds(1));
+  }
+
+  void notify() {}
+};
+
+struct spin_wait
+{
+  template<typename F>
+  void wait(F&& ready)
+  {
+    while (not ready())
+      cpu_relax();
+  }
+
+  void notify() {}
+};
+
+template<int Spins = 1000>
+struct spin_yield_wait
+{
+  template<typename F>
+  void wait(F&& ready)
+  {
+    for (int i = 0; i < Spins; i++)
+    {
+      if (ready()) return;
+      cpu_relax();
+    }
+    while (not ready())
+      std::this_thread::yield();
+  }
+
+  void notify() {}
+};
+
+// Spins, then yields, then parks on a futex. notify() only enters the kernel
+// if some waiter announced that it is about to sleep, so a producer that
+// keeps the consumer busy never makes a syscall. Waiters are counted, so any
+// number of threads may wait at once. Both sides order their store (the
+// sleeper count, resp. the published data) before their load (the data,
+// resp. the count) with a full fence, so either the waiter sees the data or
+// the notifier sees the waiter.
+template<int Spins = 1000, int Yields = 10>
+struct futex_wait
+{
+  template<typename F>
+  void wait(F&& ready)
+  {
+    for (int i = 0; i < Spins; i++)
+    {
+      if (ready()) return;
+      cpu_relax();
+    }
+    for (int i = 0; i < Yields; i++)
+    {
+      if (ready()) return;
+      std::this_thread::yield();
+    }
+    while (not ready())
+    {
+      std::uint32_t s = seq.load(std::memory_order_acquire);
+      sleepers.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (not ready())
+        syscall(SYS_futex, &seq, FUTEX_WAIT_PRIVATE, s, nullptr, nullptr, 0);
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  void notify()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) == 0) return;
+    wake_all();
+  }
+
+  // Wakes all waiters whether or not any announced itself, e.g. on shutdown.
+  void wake_all()
+  {
+    seq.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, &seq, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    wakes.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::atomic<std::uint32_t> seq{0};
+  std::atomic<std::uint32_t> sleepers{0};
+  std::atomic<std::uint64_t> wakes{0};
+};
+
+#endif /* TEST_WAIT_STRATEGY_H_ */
@@ -0,0 +1,124 @@
+#include "ddw/impl.hpp"
+#include "fifo.h"
+#include "latency.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual void handle() = 0;
+};
+
+struct count_msg : msg
+{
+  long& counter;
+  count_msg(long& c) : counter(c) {}
+  void handle() override { counter++; }
+};
+
+std::uint64_t total(const std::array<std::uint64_t, latency_histogram::buckets>& counts)
+{
+  std::uint64_t n = 0;
+  for (auto c : counts)
+    n += c;
+  return n;
+}
+
+}
+
+static_assert(sizeof(stamped<msg, 32, sizeof(void*), false>) == sizeof(ddw::impl<msg>),
+    "untraced envelope must not add to the element");
+
+TEST(latency, records_per_thread_and_scrapes)
+{
+  auto before = total(latency_histogram::scrape());
+  auto q = std::make_unique<fifo<stamped<msg, 32, sizeof(void*), true>, 1024, 64>>();
+  long counter = 0;
+  for (int i = 0; i < 10; i++)
+    q->push(count_msg(counter));
+  q->flush();
+  std::thread consumer([&]()
+  {
+    while (not q->empty())
+    {
+      auto& e = q->front();
+      e.record();
+      e->handle();
+      q->pop();
+    }
+  });
+  consumer.join();
+  auto after = latency_histogram::scrape();
+  ASSERT_EQ(10, counter);
+  ASSERT_EQ(before + 10, total(after));
+  ASSERT_GT(latency_histogram::quantile(after, 0.5), 0u);
+}
+
+namespace
+{
+
+template<typename E>
+void run_stamped(const char* name)
+{
+  const long count = 20000000;
+  auto q = std::make_unique<fifo<E>>();
+  long counter = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread writer([&]()
+  {
+    for (long i = 0; i < count; i++)
+    {
+      while (q->full())
+        std::this_thread::yield();
+      q->push(count_msg(counter));
+    }
+    q->flush();
+  });
+  std::thread reader([&]()
+  {
+    while (counter < count)
+    {
+      if (q->empty())
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      q->drain(256, [](E& e)
+      {
+        e.record();
+        e->handle();
+      });
+    }
+  });
+  writer.join();
+  reader.join();
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "fifo holding " << name << " processed " << count * 1s / (t1 - t0) << " msgs per second.\n";
+  ASSERT_EQ(count, counter);
+}
+
+}
+
+TEST(perftest, stamped_untraced)
+{
+  run_stamped<stamped<msg, 32, sizeof(void*), false>>("untraced envelopes");
+}
+
+TEST(perftest, stamped_traced)
+{
+  auto before = latency_histogram::scrape();
+  run_stamped<stamped<msg, 32, sizeof(void*), true>>("traced envelopes");
+  auto after = latency_histogram::scrape();
+  for (std::size_t i = 0; i < after.size(); i++)
+    after[i] -= before[i];
+  std::cout << "  queue residence p50 < " << latency_histogram::quantile(after, 0.5) << " ns, p99 < "
+            << latency_histogram::quantile(after, 0.99) << " ns.\n";
+}
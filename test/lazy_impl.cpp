@@ -0,0 +1,255 @@
+#include "ddw/lazy_impl.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct plugin
+{
+  virtual ~plugin() {}
+  virtual long run() = 0;
+};
+
+std::atomic<int> plugins_constructed{0};
+
+// Stands in for a plugin whose constructor builds tables or reads
+// configuration: far more work than a call through the interface.
+struct expensive_plugin : plugin
+{
+  expensive_plugin(long seed, std::string name) : name(std::move(name))
+  {
+    plugins_constructed++;
+    for (long i = 0; i < 20000; i++)
+      table = table * 6364136223846793005 + seed + i;
+  }
+
+  long run() override
+  {
+    return table + long(name.size());
+  }
+
+  long table = 0;
+  std::string name;
+};
+
+struct light_plugin : plugin
+{
+  long run() override
+  {
+    return 7;
+  }
+};
+
+}
+
+TEST(lazy_impl, constructs_on_first_use)
+{
+  plugins_constructed = 0;
+  ddw::lazy_impl<plugin, 64> p = ddw::impl_lazy<expensive_plugin>(3, std::string("name"));
+  ASSERT_TRUE(p.has_impl());
+  ASSERT_FALSE(p.built());
+  ASSERT_EQ(0, plugins_constructed);
+  long r = p->run();
+  ASSERT_TRUE(p.built());
+  ASSERT_EQ(1, plugins_constructed);
+  ASSERT_EQ(r, (*p).run());
+  ASSERT_EQ(1, plugins_constructed);
+}
+
+TEST(lazy_impl, eager_and_empty)
+{
+  ddw::lazy_impl<plugin> eager = light_plugin();
+  ASSERT_TRUE(eager.built());
+  ASSERT_EQ(7, eager->run());
+  ddw::lazy_impl<plugin> empty;
+  ASSERT_FALSE(empty.has_impl());
+  ASSERT_EQ(nullptr, empty.get());
+}
+
+TEST(lazy_impl, move)
+{
+  plugins_constructed = 0;
+  std::vector<ddw::lazy_impl<plugin, 64>> plugins;
+  for (long i = 0; i < 10; i++)
+    plugins.emplace_back(ddw::impl_lazy<expensive_plugin>(i, std::string("p")));
+  ASSERT_EQ(0, plugins_constructed);
+  plugins[3]->run();
+  ddw::lazy_impl<plugin, 64> moved = std::move(plugins[3]);
+  ASSERT_TRUE(moved.built());
+  ASSERT_EQ(moved.get(), moved.get());
+  moved = std::move(plugins[4]);
+  ASSERT_FALSE(moved.built());
+  moved->run();
+  ASSERT_EQ(2, plugins_constructed);
+  ASSERT_TRUE(moved.built());
+  moved = std::move(plugins[5]);
+  ASSERT_TRUE(moved.has_impl());
+  ASSERT_FALSE(moved.built());
+  ASSERT_NE(nullptr, moved.get());
+  ASSERT_EQ(3, plugins_constructed);
+}
+
+TEST(lazy_impl, concurrent_first_use_constructs_once)
+{
+  for (int round = 0; round < 100; round++)
+  {
+    plugins_constructed = 0;
+    ddw::lazy_impl<plugin, 64> p = ddw::impl_lazy<expensive_plugin>(round, std::string("shared"));
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    std::vector<plugin*> seen(4);
+    for (int t = 0; t < 4; t++)
+    {
+      threads.emplace_back([&, t]()
+      {
+        while (not go.load()) {}
+        seen[t] = p.get();
+      });
+    }
+    go = true;
+    for (auto& t : threads)
+      t.join();
+    ASSERT_EQ(1, plugins_constructed);
+    for (auto s : seen)
+      ASSERT_EQ(p.get(), s);
+  }
+}
+
+namespace
+{
+
+std::atomic<int> flaky_attempts{0};
+
+// Fails to construct on its first attempts.
+struct flaky_plugin : plugin
+{
+  flaky_plugin(int failures)
+  {
+    if (flaky_attempts++ < failures)
+      throw std::runtime_error("not ready");
+  }
+
+  long run() override
+  {
+    return 5;
+  }
+};
+
+}
+
+TEST(lazy_impl, throwing_constructor_is_retried)
+{
+  flaky_attempts = 0;
+  ddw::lazy_impl<plugin> p = ddw::impl_lazy<flaky_plugin>(2);
+  ASSERT_THROW(p.get(), std::runtime_error);
+  ASSERT_FALSE(p.built());
+  ASSERT_TRUE(p.has_impl());
+  ASSERT_THROW(p->run(), std::runtime_error);
+  ASSERT_EQ(5, p->run());
+  ASSERT_EQ(3, flaky_attempts);
+}
+
+TEST(lazy_impl, concurrent_first_use_with_throwing_constructor)
+{
+  for (int round = 0; round < 100; round++)
+  {
+    flaky_attempts = 0;
+    ddw::lazy_impl<plugin> p = ddw::impl_lazy<flaky_plugin>(1);
+    std::atomic<bool> go{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+      threads.emplace_back([&]()
+      {
+        while (not go.load()) {}
+        try
+        {
+          p.get();
+        }
+        catch (const std::runtime_error&)
+        {
+          failures++;
+          p.get();
+        }
+      });
+    }
+    go = true;
+    for (auto& t : threads)
+      t.join();
+    ASSERT_EQ(1, failures);
+    ASSERT_EQ(2, flaky_attempts);
+    ASSERT_EQ(5, p->run());
+  }
+}
+
+namespace
+{
+
+const long startup_plugins = 500;
+const long startup_used = 10;
+
+template<typename Holder, typename Make>
+void report_startup(const char* name, Make make)
+{
+  plugins_constructed = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<Holder> plugins;
+  plugins.reserve(startup_plugins);
+  for (long i = 0; i < startup_plugins; i++)
+    plugins.emplace_back(make(i));
+  auto t1 = std::chrono::steady_clock::now();
+  long sum = 0;
+  for (long i = 0; i < startup_used; i++)
+    sum += plugins[i * (startup_plugins / startup_used)]->run();
+  auto t2 = std::chrono::steady_clock::now();
+  std::cout << name << " startup of " << startup_plugins << " plugins took "
+            << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()
+            << " us, first use of " << startup_used << " took "
+            << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us ("
+            << plugins_constructed << " constructed, checksum " << (sum & 0xff) << ").\n";
+}
+
+}
+
+TEST(perftest, startup_eager_plugins)
+{
+  report_startup<ddw::impl<plugin, 64>>("eager ddw::impl", [](long i)
+  {
+    return ddw::impl<plugin, 64>(expensive_plugin(i, "plugin"));
+  });
+}
+
+TEST(perftest, startup_lazy_plugins)
+{
+  report_startup<ddw::lazy_impl<plugin, 64>>("ddw::lazy_impl", [](long i)
+  {
+    return ddw::impl_lazy<expensive_plugin>(i, std::string("plugin"));
+  });
+}
+
+TEST(perftest, lazy_impl_dereference)
+{
+  ddw::lazy_impl<plugin> p = ddw::impl_lazy<light_plugin>();
+  ddw::impl<plugin> eager = light_plugin();
+  const long n = 100000000;
+  auto t0 = std::chrono::steady_clock::now();
+  long sum = 0;
+  for (long i = 0; i < n; i++)
+    sum += p->run();
+  auto t1 = std::chrono::steady_clock::now();
+  for (long i = 0; i < n; i++)
+    sum += eager->run();
+  auto t2 = std::chrono::steady_clock::now();
+  std::cout << "ddw::lazy_impl built processed " << n * 1s / (t1 - t0) << " msgs per second, ddw::impl "
+            << n * 1s / (t2 - t1) << ".\n";
+  ASSERT_EQ(2 * n * 7, sum);
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Reports the code size of the objects of the default and the
+# -fno-exceptions -fno-rtti build, then runs the impl benchmarks of both.
+# usage: report.sh <baseline binary> <lean binary> <baseline obj dir> <lean obj dir>
+
+text() {
+  find "$1" -name '*.o' -exec size -A {} \; | awk '$1 ~ /^\.text/ { s += $2 } END { print s }'
+}
+
+eh() {
+  find "$1" -name '*.o' -exec size -A {} \; | awk '$1 ~ /^\.(gcc_except_table|eh_frame)/ { s += $2 } END { print s + 0 }'
+}
+
+echo "default: $(text "$3") bytes of code, $(eh "$3") bytes of unwind tables"
+echo "lean:    $(text "$4") bytes of code, $(eh "$4") bytes of unwind tables"
+
+for bin in "$1" "$2"
+do
+  echo "$(basename "$bin"):"
+  "$bin" --gtest_filter='perftest.*_impl*' | grep 'per second'
+done
@@ -0,0 +1,174 @@
+#include "ddw/impl.hpp"
+#include "ddw/parallel.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct shape
+{
+  virtual ~shape() {}
+  virtual long area() const = 0;
+  virtual void grow() = 0;
+};
+
+struct square : shape
+{
+  long side;
+  square(long s) : side(s) {}
+  long area() const override { return side * side; }
+  void grow() override { side++; }
+};
+
+struct rect : shape
+{
+  long w, h;
+  rect(long w, long h) : w(w), h(h) {}
+  long area() const override { return w * h; }
+  void grow() override { w++; }
+};
+
+using shape_impl = ddw::impl<shape, 16>;
+
+std::vector<shape_impl> make_shapes(std::size_t n)
+{
+  std::vector<shape_impl> shapes;
+  shapes.reserve(n);
+  std::mt19937 rng(42);
+  for (std::size_t i = 0; i < n; i++)
+  {
+    if (rng() % 2)
+      shapes.emplace_back(square(i % 7));
+    else
+      shapes.emplace_back(rect(i % 5, 2));
+  }
+  return shapes;
+}
+
+long serial_area(const std::vector<shape_impl>& shapes)
+{
+  long sum = 0;
+  for (auto& s : shapes)
+    sum += s->area();
+  return sum;
+}
+
+long parallel_area(std::vector<shape_impl>& shapes, ddw::parallel_options o)
+{
+  return ddw::parallel_transform_reduce(shapes.begin(), shapes.end(), 0L,
+      [](long a, long b) { return a + b; }, [](shape_impl& s) { return s->area(); }, o);
+}
+
+}
+
+TEST(parallel, for_each_visits_every_element_once)
+{
+  auto shapes = make_shapes(100003);
+  long before = serial_area(shapes);
+  for (bool group : {false, true})
+  {
+    ddw::parallel_options o;
+    o.group_by_type = group;
+    ddw::parallel_for_each(shapes.begin(), shapes.end(), [](shape_impl& s) { s->grow(); }, o);
+  }
+  long after = 0;
+  for (std::size_t i = 0; i < shapes.size(); i++)
+    after += shapes[i]->area();
+  ASSERT_GT(after, before);
+  auto fresh = make_shapes(100003);
+  for (auto& s : fresh)
+  {
+    s->grow();
+    s->grow();
+  }
+  ASSERT_EQ(serial_area(fresh), after);
+}
+
+TEST(parallel, transform_reduce_matches_serial)
+{
+  auto shapes = make_shapes(100003);
+  long expected = serial_area(shapes);
+  for (std::size_t threads : {1, 2, 4})
+    for (bool group : {false, true})
+    {
+      ddw::parallel_options o;
+      o.threads = threads;
+      o.group_by_type = group;
+      ASSERT_EQ(expected, parallel_area(shapes, o));
+    }
+  std::vector<shape_impl> none;
+  ASSERT_EQ(7, ddw::parallel_transform_reduce(none.begin(), none.end(), 7L,
+      [](long a, long b) { return a + b; }, [](shape_impl& s) { return s->area(); }));
+}
+
+TEST(parallel, nested_runs_serially)
+{
+  std::vector<int> outer(64);
+  std::atomic<long> inner{0};
+  ddw::parallel_for_each(outer.begin(), outer.end(), [&](int&)
+  {
+    std::vector<int> v(100, 1);
+    inner += ddw::parallel_transform_reduce(v.begin(), v.end(), 0L,
+        [](long a, long b) { return a + b; }, [](int x) { return long(x); });
+  });
+  ASSERT_EQ(6400, inner);
+}
+
+TEST(parallel, exception_from_body)
+{
+  std::vector<int> v(10000, 1);
+  ddw::parallel_options o;
+  o.chunk = 16;
+  for (int round = 0; round < 20; round++)
+  {
+    std::atomic<long> visited{0};
+    ASSERT_THROW(ddw::parallel_for_each(v.begin(), v.end(), [&](int& x)
+    {
+      visited++;
+      if (&x == &v[round * 100])
+        throw std::runtime_error("body failed");
+    }, o), std::runtime_error);
+    ASSERT_LE(visited, 10000);
+  }
+  // The pool is still usable afterwards.
+  std::atomic<long> sum{0};
+  ddw::parallel_for_each(v.begin(), v.end(), [&](int& x) { sum += x; }, o);
+  ASSERT_EQ(10000, sum);
+  long total = ddw::parallel_transform_reduce(v.begin(), v.end(), 0L,
+      [](long a, long b) { return a + b; }, [](int x) { return long(x); }, o);
+  ASSERT_EQ(10000, total);
+}
+
+TEST(perftest, parallel_transform_reduce_scaling)
+{
+  const std::size_t count = 10000000;
+  auto shapes = make_shapes(count);
+  long expected = serial_area(shapes);
+  std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::size_t> steps;
+  for (std::size_t threads = 1; threads < cores; threads *= 2)
+    steps.push_back(threads);
+  steps.push_back(cores);
+  for (bool group : {false, true})
+    for (std::size_t threads : steps)
+    {
+      ddw::parallel_options o;
+      o.threads = threads;
+      o.group_by_type = group;
+      auto t0 = std::chrono::steady_clock::now();
+      long sum = parallel_area(shapes, o);
+      auto t1 = std::chrono::steady_clock::now();
+      std::cout << "parallel_transform_reduce over " << count << " ddw::impl<shape> on " << threads << " threads"
+                << (group ? " grouped by type" : "") << " processed " << count * 1s / (t1 - t0) << " elements per second.\n";
+      ASSERT_EQ(expected, sum);
+    }
+}
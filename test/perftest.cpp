@@ -1,5 +1,8 @@
 #include "ddw/impl.hpp"
+#include "ddw/fn.hpp"
 #include "fifo.h"
+#include "perf_counters.h"
+#include "wait_strategy.h"
 #include <gtest/gtest.h>
 #include <functional>
 #include <thread>
@@ -60,12 +63,17 @@ struct done_msg : msg
 
 const std::chrono::nanoseconds target_duration = 1s;
 const int interval_count = 10000;
+const std::size_t drain_batch = 256;
 
-template<typename T>
+// The writer and the reader block on a full, resp. empty queue through Wait,
+// and notify the other side whenever they publish a batch.
+template<typename T, typename Wait = futex_wait<>>
 struct perftest_ctx
 {
   std::string description;
   fifo<T> queue;
+  Wait not_full;
+  Wait not_empty;
   bool done = false;
   int expected_counter = 0;
   int counter = 0;
@@ -75,32 +83,61 @@ struct perftest_ctx
   template<class F1, class F2, class F3>
   void run(F1 post_count, F2 post_done, F3 handle)
   {
+    measure(post_count, post_done, [&]()
+    {
+      handle(queue.front());
+      queue.pop();
+    });
+  }
+
+  template<class F1, class F2, class F3>
+  void run_drain(F1 post_count, F2 post_done, F3 handle)
+  {
+    description += " (drained)";
+    measure(post_count, post_done, [&]() { queue.drain(drain_batch, handle); });
+  }
+
+  template<class F1, class F2, class F3>
+  void measure(F1 post_count, F2 post_done, F3 consume)
+  {
+    perf_counters pc;
+    pc.start();
     auto t0 = std::chrono::steady_clock::now();
 
     std::thread writer([&]()
     {
+      std::size_t published = queue.tail;
       while (std::chrono::steady_clock::now() - t0 < target_duration)
       {
         expected_counter += interval_count;
         for (int i = 0; i < interval_count; i++)
         {
-          while (queue.full())
-            std::this_thread::sleep_for(1us);
+          not_full.wait([&]() { return not queue.full(); });
           post_count();
+          if (queue.tail != published)
+          {
+            published = queue.tail;
+            not_empty.notify();
+          }
         }
       }
       post_done();
       queue.flush();
+      not_empty.notify();
     });
 
     std::thread reader([&]()
     {
+      std::size_t released = queue.head;
       while (not done)
       {
-        while (queue.empty())
-          std::this_thread::sleep_for(1us);
-        handle(queue.front());
-        queue.pop();
+        not_empty.wait([&]() { return not queue.empty(); });
+        consume();
+        if (queue.head != released)
+        {
+          released = queue.head;
+          not_full.notify();
+        }
       }
     });
 
@@ -108,8 +145,10 @@ struct perftest_ctx
     writer.join();
 
     auto t1 = std::chrono::steady_clock::now();
+    pc.stop();
 
     std::cout << "fifo holding " << description << " objects processed " << counter * 1s / (t1 - t0) << " msgs per second.\n";
+    pc.report(std::cout, counter);
 
     ASSERT_EQ(expected_counter, counter);
   }
@@ -140,6 +179,14 @@ TEST(perftest, small_std_function_trick)
       [&ctx]() { ctx.queue.push([m = done_msg(ctx.done)]() mutable -> msg& { return m; }); },
       [](std::function<msg&()>& m) { m().handle(); });
 }
+TEST(perftest, small_ddw_fn)
+{
+  perftest_ctx<ddw::fn<void()>> ctx("small ddw::fn<void()>");
+  ctx.run(
+      [&ctx]() { ctx.queue.push([capt = small_capture(), &counter = ctx.counter]() { counter++; }); },
+      [&ctx]() { ctx.queue.push([&done = ctx.done]() { done = true; }); },
+      [](ddw::fn<void()>& m) { m(); });
+}
 TEST(perftest, small_impl)
 {
   perftest_ctx<ddw::impl<msg>> ctx("small ddw::impl<msg>");
@@ -165,6 +212,14 @@ TEST(perftest, medium_std_function_trick)
       [](std::function<msg&()>& m) { m().handle(); });
   ASSERT_TRUE(true);
 }
+TEST(perftest, medium_ddw_fn)
+{
+  perftest_ctx<ddw::fn<void()>> ctx("medium ddw::fn<void()>");
+  ctx.run(
+      [&ctx]() { ctx.queue.push([capt = medium_capture(), &counter = ctx.counter]() { counter++; }); },
+      [&ctx]() { ctx.queue.push([&done = ctx.done]() { done = true; }); },
+      [](ddw::fn<void()>& m) { m(); });
+}
 TEST(perftest, medium_impl)
 {
   perftest_ctx<ddw::impl<msg>> ctx("medium ddw::impl<msg>");
@@ -189,6 +244,24 @@ TEST(perftest, large_std_function_trick)
       [&ctx]() { ctx.queue.push([m = done_msg(ctx.done)]() mutable -> msg& { return m; }); },
       [](std::function<msg&()>& m) { m().handle(); });
 }
+TEST(perftest, large_ddw_fn)
+{
+  perftest_ctx<ddw::fn<void()>> ctx("large ddw::fn<void()>");
+  ctx.run(
+      [&ctx]() { ctx.queue.push([capt = large_capture(), &counter = ctx.counter]() { counter++; }); },
+      [&ctx]() { ctx.queue.push([&done = ctx.done]() { done = true; }); },
+      [](ddw::fn<void()>& m) { m(); });
+}
+TEST(perftest, large_ddw_fn_fit)
+{
+  using large_fn = ddw::fn<void(), 176>;
+  auto heap_ctx = std::make_unique<perftest_ctx<large_fn>>("large ddw::fn<void(), 176>");
+  auto& ctx = *heap_ctx;
+  ctx.run(
+      [&ctx]() { ctx.queue.push(ddw::impl_by_small_value([capt = large_capture(), &counter = ctx.counter]() { counter++; })); },
+      [&ctx]() { ctx.queue.push([&done = ctx.done]() { done = true; }); },
+      [](large_fn& m) { m(); });
+}
 TEST(perftest, large_impl)
 {
   perftest_ctx<ddw::impl<msg>> ctx("large ddw::impl<msg>");
@@ -197,3 +270,27 @@ TEST(perftest, large_impl)
       [&ctx]() { ctx.queue.push(done_msg(ctx.done)); },
       [](ddw::impl<msg>& m) { m->handle(); });
 }
+TEST(perftest, small_impl_sleep_wait)
+{
+  perftest_ctx<ddw::impl<msg>, sleep_wait> ctx("small ddw::impl<msg> (polling with sleep)");
+  ctx.run(
+      [&ctx]() { ctx.queue.push(count_msg<small_capture>(ctx.counter)); },
+      [&ctx]() { ctx.queue.push(done_msg(ctx.done)); },
+      [](ddw::impl<msg>& m) { m->handle(); });
+}
+TEST(perftest, small_impl_drain)
+{
+  perftest_ctx<ddw::impl<msg>> ctx("small ddw::impl<msg>");
+  ctx.run_drain(
+      [&ctx]() { ctx.queue.push(count_msg<small_capture>(ctx.counter)); },
+      [&ctx]() { ctx.queue.push(done_msg(ctx.done)); },
+      [](ddw::impl<msg>& m) { m->handle(); });
+}
+TEST(perftest, large_impl_drain)
+{
+  perftest_ctx<ddw::impl<msg>> ctx("large ddw::impl<msg>");
+  ctx.run_drain(
+      [&ctx]() { ctx.queue.push(count_msg<large_capture>(ctx.counter)); },
+      [&ctx]() { ctx.queue.push(done_msg(ctx.done)); },
+      [](ddw::impl<msg>& m) { m->handle(); });
+}
@@ -0,0 +1,117 @@
+#include "ddw/impl.hpp"
+#include "pipeline.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual void visit(std::size_t stage) = 0;
+  virtual int hops() const = 0;
+};
+
+struct Tracker
+{
+  std::atomic<long> value_constructed{0};
+  std::atomic<long> move_constructed{0};
+  std::atomic<long> copy_constructed{0};
+  std::atomic<long> destructed{0};
+};
+
+struct tracked_msg : msg
+{
+  static Tracker* tracker;
+  tracked_msg(long id) : id(id) { tracker->value_constructed++; }
+  tracked_msg(const tracked_msg& o) : id(o.id), stages(o.stages) { tracker->copy_constructed++; }
+  tracked_msg(tracked_msg&& o) : id(o.id), stages(o.stages) { tracker->move_constructed++; }
+  ~tracked_msg() { tracker->destructed++; }
+  void visit(std::size_t stage) override { stages |= 1u << stage; }
+  int hops() const override { return __builtin_popcount(stages); }
+  long id;
+  unsigned stages = 0;
+  int payload[3] = {};
+};
+Tracker* tracked_msg::tracker = nullptr;
+
+using msg_pipeline = pipeline<msg>;
+
+void run_pipeline(msg_pipeline& p, long count, std::vector<long>& complete)
+{
+  std::vector<std::thread> stages;
+  for (std::size_t s = 0; s < p.stages(); s++)
+  {
+    stages.emplace_back([&p, s, count, &complete]()
+    {
+      bool last = s + 1 == p.stages();
+      long handled = 0;
+      while (handled < count)
+      {
+        std::size_t n = p.process(s, [&](msg_pipeline::value_type& m)
+        {
+          m->visit(s);
+          if (last and m->hops() == int(p.stages())) complete[s]++;
+        });
+        handled += n;
+        if (n == 0) std::this_thread::yield();
+      }
+    });
+  }
+  for (long i = 0; i < count; i++)
+  {
+    while (p.full())
+    {
+      p.flush();
+      std::this_thread::yield();
+    }
+    p.emplace<tracked_msg>(i);
+  }
+  p.flush();
+  for (auto& t : stages)
+    t.join();
+}
+
+}
+
+TEST(pipeline, constructs_once_and_never_moves)
+{
+  Tracker t;
+  tracked_msg::tracker = &t;
+  {
+    msg_pipeline p(4);
+    std::vector<long> complete(4);
+    run_pipeline(p, 100000, complete);
+    ASSERT_EQ(100000, complete[3]);
+  }
+  ASSERT_EQ(100000, t.value_constructed);
+  ASSERT_EQ(0, t.move_constructed);
+  ASSERT_EQ(0, t.copy_constructed);
+  ASSERT_EQ(100000, t.destructed);
+}
+
+TEST(perftest, pipeline_impl)
+{
+  Tracker t;
+  tracked_msg::tracker = &t;
+  const long count = 2000000;
+  msg_pipeline p(5);
+  std::vector<long> complete(5);
+  auto t0 = std::chrono::steady_clock::now();
+  run_pipeline(p, count, complete);
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << "5-stage pipeline holding ddw::impl<msg> objects processed " << count * 1s / (t1 - t0)
+            << " msgs per second with " << t.value_constructed << " constructions and " << t.move_constructed << " moves.\n";
+
+  ASSERT_EQ(count, complete[4]);
+  ASSERT_EQ(count, t.value_constructed);
+  ASSERT_EQ(0, t.move_constructed);
+  ASSERT_EQ(0, t.copy_constructed);
+}
@@ -0,0 +1,159 @@
+#include "ddw/impl.hpp"
+#include "reclaimer.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual long handle() = 0;
+  virtual bool expensive_destructor() const { return false; }
+};
+
+struct cheap_msg : msg
+{
+  static long destructed;
+  cheap_msg(long v) : v(v) {}
+  ~cheap_msg() { destructed++; }
+  long handle() override { return v; }
+  long v;
+};
+long cheap_msg::destructed = 0;
+
+// Owns a buffer that is wiped before it is released.
+struct heavy_msg : msg
+{
+  static std::atomic<long> destructed;
+  heavy_msg(std::size_t size) : size(size), buffer(std::make_unique<char[]>(size)) {}
+  heavy_msg(heavy_msg&&) = default;
+  ~heavy_msg()
+  {
+    if (not buffer) return;
+    std::memset(buffer.get(), 0, size);
+    asm volatile("" : : "r"(buffer.get()) : "memory");
+    destructed++;
+  }
+  long handle() override { return buffer[0]; }
+  bool expensive_destructor() const override { return true; }
+  std::size_t size;
+  std::unique_ptr<char[]> buffer;
+};
+std::atomic<long> heavy_msg::destructed{0};
+
+using list = retire_list<msg>;
+using queue = fifo<list::value_type, 1024, 64>;
+
+}
+
+TEST(retire_list, cheap_destroyed_inline)
+{
+  cheap_msg::destructed = 0;
+  list l;
+  list::value_type v = cheap_msg(1);
+  long before = cheap_msg::destructed;
+  l.retire(v);
+  ASSERT_TRUE(v);
+  v.reset();
+  ASSERT_EQ(before + 1, cheap_msg::destructed);
+  ASSERT_EQ(0u, l.collect());
+}
+
+TEST(retire_list, heavy_deferred_until_collect)
+{
+  heavy_msg::destructed = 0;
+  list l;
+  for (int i = 0; i < 10; i++)
+  {
+    list::value_type v = ddw::impl_emplace<heavy_msg>(std::size_t(4096));
+    l.retire(v);
+    ASSERT_FALSE(v);
+  }
+  ASSERT_EQ(0, heavy_msg::destructed);
+  l.flush();
+  ASSERT_EQ(4u, l.collect(4));
+  ASSERT_EQ(4, heavy_msg::destructed);
+  ASSERT_EQ(6u, l.collect());
+  ASSERT_EQ(10, heavy_msg::destructed);
+}
+
+TEST(retire_list, background_reclaimer)
+{
+  heavy_msg::destructed = 0;
+  auto l = std::make_unique<list>();
+  {
+    background_reclaimer<list> r({l.get()});
+    for (int i = 0; i < 10000; i++)
+    {
+      list::value_type v = ddw::impl_emplace<heavy_msg>(std::size_t(256));
+      l->retire(v);
+    }
+    l->flush();
+  }
+  ASSERT_EQ(10000, heavy_msg::destructed);
+}
+
+namespace
+{
+
+enum class reclaim { inline_, idle_hook, background };
+
+// Handles count heavy messages and reports the time the consumer spends
+// between taking a message and being ready for the next one.
+void run_heavy(reclaim mode, const char* name)
+{
+  const int count = 20000;
+  const std::size_t size = 256 * 1024;
+  auto q = std::make_unique<queue>();
+  auto l = std::make_unique<list>();
+  std::unique_ptr<background_reclaimer<list>> r;
+  if (mode == reclaim::background)
+    r = std::make_unique<background_reclaimer<list>>(std::vector<list*>{l.get()});
+  std::vector<std::chrono::nanoseconds> service(count);
+  long sum = 0;
+  for (int i = 0; i < count; i++)
+  {
+    q->push(ddw::impl_emplace<heavy_msg>(size));
+    q->flush();
+    auto t0 = std::chrono::steady_clock::now();
+    sum += q->front()->handle();
+    if (mode != reclaim::inline_)
+      l->retire(q->front());
+    q->pop();
+    auto t1 = std::chrono::steady_clock::now();
+    service[i] = t1 - t0;
+    l->flush();
+    if (mode == reclaim::idle_hook and i % 64 == 63)
+      l->collect();
+  }
+  while (mode == reclaim::idle_hook and l->collect()) {}
+  r.reset();
+  std::sort(service.begin(), service.end());
+  std::cout << name << " handled heavy messages with p50 " << service[count / 2].count()
+            << " ns and p99 " << service[count * 99 / 100].count() << " ns per message.\n";
+  ASSERT_EQ(0, sum);
+}
+
+}
+
+TEST(perftest, heavy_destructor_inline)
+{
+  run_heavy(reclaim::inline_, "inline destruction");
+}
+
+TEST(perftest, heavy_destructor_idle_hook)
+{
+  run_heavy(reclaim::idle_hook, "idle-time retire list");
+}
+
+TEST(perftest, heavy_destructor_background)
+{
+  run_heavy(reclaim::background, "background reclaimer");
+}
@@ -0,0 +1,334 @@
+#include "shm_ring.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct shm_msg
+{
+  virtual ~shm_msg() {}
+  virtual long handle() const = 0;
+};
+
+struct ping : shm_msg
+{
+  ping(long id = 0) : id(id) {}
+  long handle() const override { return id; }
+  long id;
+};
+
+struct stamped : shm_msg
+{
+  stamped(std::int64_t sent = 0) : sent(sent) {}
+  long handle() const override { return -1; }
+  std::int64_t sent;
+  char payload[24] = {};
+};
+
+}
+
+namespace ddw
+{
+template<> struct impl_trivially_movable<ping> : std::true_type {};
+template<> struct impl_trivially_movable<stamped> : std::true_type {};
+}
+
+namespace
+{
+
+using ring = shm_ring<shm_msg>;
+
+std::string ring_name(const char* test)
+{
+  return "/ddw_shm_ring_" + std::to_string(getpid()) + "_" + test;
+}
+
+std::int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename U>
+void emplace(ring& r, const U& u)
+{
+  while (not r.try_emplace<U>(u))
+    sched_yield();
+}
+
+// Runs producer in a forked child that opens the ring by name.
+template<typename F>
+pid_t fork_producer(const std::string& name, F&& producer)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    ring r(name, false);
+    r.register_type<ping>(1, ping());
+    r.register_type<stamped>(2, stamped());
+    producer(r);
+    _exit(0);
+  }
+  return pid;
+}
+
+// Runs the shm_ring.DISABLED_<test> producer in a fresh image of this binary
+// rather than a fork, so that its vtables are mapped at other addresses than
+// ours (with ASLR) and the consumer's vptr fix-up is actually exercised.
+pid_t exec_producer(const std::string& name, const char* test, long count)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    int null = ::open("/dev/null", O_WRONLY);
+    dup2(null, 1);
+    setenv("DDW_SHM_RING", name.c_str(), 1);
+    setenv("DDW_SHM_RING_COUNT", std::to_string(count).c_str(), 1);
+    std::string filter = std::string("--gtest_filter=shm_ring.DISABLED_") + test;
+    execl("/proc/self/exe", "unit_test_binary", filter.c_str(), "--gtest_also_run_disabled_tests",
+        static_cast<char*>(nullptr));
+    _exit(127);
+  }
+  return pid;
+}
+
+const void* vptr_of(const shm_msg& m)
+{
+  const void* v;
+  std::memcpy(&v, &m, sizeof(v));
+  return v;
+}
+
+bool aslr_enabled()
+{
+  std::ifstream f("/proc/sys/kernel/randomize_va_space");
+  int level = 0;
+  f >> level;
+  return level != 0;
+}
+
+// Waits until r has a message from the producer pid. Returns false if the
+// producer exited (reaping it into status) or sent nothing for 30 seconds.
+bool wait_message(ring& r, pid_t pid, int& status, bool& exited)
+{
+  auto deadline = std::chrono::steady_clock::now() + 30s;
+  while (r.empty())
+  {
+    if (exited or std::chrono::steady_clock::now() > deadline)
+      return false;
+    if (waitpid(pid, &status, WNOHANG) == pid)
+      exited = true;
+    else
+      sched_yield();
+  }
+  return true;
+}
+
+struct unregistered : shm_msg
+{
+  long handle() const override { return 0; }
+};
+
+}
+
+TEST(shm_ring, push_pop)
+{
+  ring r(ring_name("push_pop"), true);
+  r.register_type<ping>(1, ping());
+  ASSERT_TRUE(r.empty());
+  ASSERT_TRUE(r.try_emplace<ping>(42));
+  ASSERT_FALSE(r.empty());
+  ASSERT_EQ(42, r.front().handle());
+  r.pop();
+  ASSERT_TRUE(r.empty());
+}
+
+TEST(shm_ring, full)
+{
+  shm_ring<shm_msg, 64, 4> r(ring_name("full"), true);
+  r.register_type<ping>(1, ping());
+  for (long i = 0; i < 4; i++)
+    ASSERT_TRUE(r.try_emplace<ping>(i));
+  ASSERT_FALSE(r.try_emplace<ping>(4));
+  r.pop();
+  ASSERT_TRUE(r.try_emplace<ping>(4));
+}
+
+TEST(shm_ring, type_table_is_shared)
+{
+  std::string name = ring_name("type_table");
+  ring a(name, true);
+  ring b(name, false);
+  a.register_type<ping>(1, ping());
+  ASSERT_THROW(b.register_type<stamped>(1, stamped()), std::runtime_error);
+  ASSERT_THROW(b.register_type<ping>(ring::max_types, ping()), std::invalid_argument);
+}
+
+TEST(shm_ring, unregistered_types)
+{
+  std::string name = ring_name("unregistered");
+  ring a(name, true);
+  ring b(name, false);
+  ASSERT_THROW(a.try_emplace<unregistered>(), std::logic_error);
+  a.register_type<ping>(1, ping());
+  a.register_type<stamped>(2, stamped());
+  b.register_type<ping>(1, ping());
+  // Registrations belong to a ring instance, not to the process.
+  ASSERT_THROW(b.try_emplace<stamped>(0), std::logic_error);
+  ASSERT_TRUE(a.try_emplace<stamped>(0));
+  ASSERT_THROW(b.front(), std::runtime_error);
+  ASSERT_THROW(b.pop(), std::runtime_error);
+  ASSERT_FALSE(b.empty());
+  a.pop();
+  ASSERT_TRUE(b.empty());
+}
+
+// Producer side of across_processes, only run through exec_producer(): sends
+// the address of its own ping vtable, then pings 0 to count - 1.
+TEST(shm_ring, DISABLED_producer)
+{
+  const char* name = std::getenv("DDW_SHM_RING");
+  if (not name) return;
+  long count = std::atol(std::getenv("DDW_SHM_RING_COUNT"));
+  ring w(name, false);
+  w.register_type<ping>(1, ping());
+  w.register_type<stamped>(2, stamped());
+  emplace(w, stamped(reinterpret_cast<std::intptr_t>(vptr_of(ping()))));
+  for (long i = 0; i < count; i++)
+    emplace(w, ping(i));
+}
+
+TEST(shm_ring, across_processes)
+{
+  const long count = 100000;
+  std::string name = ring_name("across_processes");
+  ring r(name, true);
+  r.register_type<ping>(1, ping());
+  r.register_type<stamped>(2, stamped());
+  pid_t pid = exec_producer(name, "producer", count);
+  int status = 0;
+  bool exited = false;
+  auto stalled = [&]()
+  {
+    if (not exited)
+    {
+      kill(pid, SIGKILL);
+      waitpid(pid, &status, 0);
+    }
+    return "producer stopped sending, status " + std::to_string(status);
+  };
+  if (not wait_message(r, pid, status, exited))
+    FAIL() << stalled();
+  auto producer_vptr = reinterpret_cast<const void*>(static_cast<stamped&>(r.front()).sent);
+  if (aslr_enabled())
+  {
+    EXPECT_NE(vptr_of(ping()), producer_vptr);
+  }
+  r.pop();
+  long sum = 0;
+  for (long i = 0; i < count; i++)
+  {
+    if (not wait_message(r, pid, status, exited))
+      FAIL() << stalled();
+    // Every other message is destroyed without being looked at first.
+    if (i % 2 == 0)
+    {
+      ASSERT_EQ(i, r.front().handle());
+      sum += r.front().handle();
+    }
+    r.pop();
+  }
+  if (not exited)
+    waitpid(pid, &status, 0);
+  ASSERT_EQ(0, status);
+  ASSERT_EQ(count / 2 * (count - 2) / 2, sum);
+}
+
+TEST(perftest, shm_ring_two_processes)
+{
+  const long count = 2000000;
+  std::string name = ring_name("perftest");
+  ring r(name, true);
+  r.register_type<ping>(1, ping());
+  r.register_type<stamped>(2, stamped());
+  auto t0 = std::chrono::steady_clock::now();
+  pid_t pid = fork_producer(name, [&](ring& w)
+  {
+    for (long i = 0; i < count; i++)
+      emplace(w, stamped(now_ns()));
+  });
+  std::int64_t latency = 0;
+  for (long i = 0; i < count; )
+  {
+    if (r.empty())
+    {
+      sched_yield();
+      continue;
+    }
+    latency += now_ns() - static_cast<stamped&>(r.front()).sent;
+    r.pop();
+    i++;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  waitpid(pid, nullptr, 0);
+
+  std::cout << "shm_ring between two processes processed " << count * 1s / (t1 - t0)
+            << " msgs per second with " << latency / count << " ns mean latency.\n";
+}
+
+TEST(perftest, unix_socket_two_processes)
+{
+  const long count = 500000;
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  auto t0 = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    close(fds[0]);
+    for (long i = 0; i < count; i++)
+    {
+      char m[sizeof(std::int64_t) + sizeof(stamped::payload)] = {};
+      std::int64_t sent = now_ns();
+      std::memcpy(m, &sent, sizeof(sent));
+      if (write(fds[1], m, sizeof(m)) < 0)
+        _exit(1);
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  std::int64_t latency = 0;
+  char buf[sizeof(std::int64_t) + sizeof(stamped::payload)];
+  std::size_t got = 0;
+  for (long i = 0; i < count; )
+  {
+    ssize_t n = read(fds[0], buf + got, sizeof(buf) - got);
+    ASSERT_GT(n, 0);
+    got += n;
+    if (got < sizeof(buf)) continue;
+    std::int64_t sent;
+    std::memcpy(&sent, buf, sizeof(sent));
+    latency += now_ns() - sent;
+    got = 0;
+    i++;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  close(fds[0]);
+  waitpid(pid, nullptr, 0);
+
+  std::cout << "unix socket between two processes processed " << count * 1s / (t1 - t0)
+            << " msgs per second with " << latency / count << " ns mean latency.\n";
+}
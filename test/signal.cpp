@@ -0,0 +1,194 @@
+#include "ddw/signal.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct listener
+{
+  virtual ~listener() {}
+  virtual void on_event(int v) = 0;
+};
+
+struct sum_listener : listener
+{
+  long& sum;
+  sum_listener(long& s) : sum(s) {}
+  void on_event(int v) override { sum += v; }
+};
+
+struct self_disconnecting : listener
+{
+  ddw::signal<listener>& sig;
+  ddw::signal<listener>::connection& self;
+  int& calls;
+  self_disconnecting(ddw::signal<listener>& s, ddw::signal<listener>::connection& c, int& calls)
+    : sig(s), self(c), calls(calls) {}
+  void on_event(int) override { calls++; sig.disconnect(self); }
+};
+
+// Disconnects itself once another thread is known to be in connect().
+struct racing_self_disconnecting : listener
+{
+  ddw::signal<listener>& sig;
+  ddw::signal<listener>::connection& self;
+  std::atomic<bool>& emitting;
+  racing_self_disconnecting(ddw::signal<listener>& s, ddw::signal<listener>::connection& c, std::atomic<bool>& e)
+    : sig(s), self(c), emitting(e) {}
+  void on_event(int) override
+  {
+    emitting = true;
+    std::this_thread::sleep_for(1ms);
+    sig.disconnect(self);
+  }
+};
+
+}
+
+TEST(signal, connect_emit_disconnect)
+{
+  ddw::signal<listener> sig;
+  long by_value = 0;
+  long by_reference = 0;
+  sum_listener ref(by_reference);
+  auto c1 = sig.connect(sum_listener(by_value));
+  auto c2 = sig.connect(ddw::impl_by_reference(ref));
+  sig.emit([](listener& l) { l.on_event(3); });
+  ASSERT_EQ(3, by_value);
+  ASSERT_EQ(3, by_reference);
+  ASSERT_TRUE(sig.disconnect(c1));
+  ASSERT_FALSE(sig.disconnect(c1));
+  sig.emit([](listener& l) { l.on_event(4); });
+  ASSERT_EQ(3, by_value);
+  ASSERT_EQ(7, by_reference);
+  ASSERT_TRUE(sig.disconnect(c2));
+  ASSERT_EQ(0u, sig.size());
+}
+
+TEST(signal, disconnect_from_listener)
+{
+  ddw::signal<listener> sig;
+  ddw::signal<listener>::connection c;
+  int calls = 0;
+  c = sig.connect(self_disconnecting(sig, c, calls));
+  sig.emit([](listener& l) { l.on_event(1); });
+  sig.emit([](listener& l) { l.on_event(1); });
+  ASSERT_EQ(1, calls);
+  ASSERT_EQ(0u, sig.size());
+}
+
+TEST(signal, disconnect_from_listener_while_another_thread_connects)
+{
+  ddw::signal<listener> sig;
+  long sum = 0;
+  for (int round = 0; round < 20; round++)
+  {
+    ddw::signal<listener>::connection c;
+    std::atomic<bool> emitting{false};
+    c = sig.connect(racing_self_disconnecting(sig, c, emitting));
+    std::thread other([&]()
+    {
+      while (not emitting)
+        std::this_thread::yield();
+      // Waits for the emit below in synchronize() while it disconnects.
+      sig.disconnect(sig.connect(sum_listener(sum)));
+    });
+    sig.emit([](listener& l) { l.on_event(1); });
+    other.join();
+    ASSERT_EQ(0u, sig.size());
+  }
+}
+
+namespace
+{
+
+const int listener_count = 16;
+
+template<typename Emit, typename Churn>
+void perftest_emit(const char* description, Emit emit, Churn churn)
+{
+  std::atomic<bool> stop{false};
+  std::thread connector([&]()
+  {
+    while (not stop)
+    {
+      churn();
+      std::this_thread::sleep_for(100us);
+    }
+  });
+  long count = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - t0 < 1s)
+  {
+    for (int i = 0; i < 1000; i++)
+      emit();
+    count += 1000;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  stop = true;
+  connector.join();
+
+  std::cout << description << " performed " << count * 1s / (t1 - t0) << " emits to " << listener_count << " listeners per second.\n";
+}
+
+}
+
+TEST(perftest, virtual_call_loop)
+{
+  long sum = 0;
+  std::vector<std::unique_ptr<listener>> listeners;
+  for (int i = 0; i < listener_count; i++)
+    listeners.push_back(std::make_unique<sum_listener>(sum));
+  perftest_emit("loop of virtual calls",
+      [&]() { for (auto& l : listeners) l->on_event(1); },
+      []() {});
+  ASSERT_NE(0, sum);
+}
+
+TEST(perftest, signal_impl_emit)
+{
+  long sum = 0;
+  long churn_sum = 0;
+  ddw::signal<listener> sig;
+  for (int i = 0; i < listener_count; i++)
+    sig.connect(sum_listener(sum));
+  perftest_emit("ddw::signal<listener> with concurrent connects",
+      [&]() { sig.emit([](listener& l) { l.on_event(1); }); },
+      [&]() { sig.disconnect(sig.connect(sum_listener(churn_sum))); });
+  ASSERT_NE(0, sum);
+}
+
+TEST(perftest, mutex_shared_ptr_emit)
+{
+  long sum = 0;
+  long churn_sum = 0;
+  std::mutex m;
+  std::vector<std::shared_ptr<listener>> listeners;
+  for (int i = 0; i < listener_count; i++)
+    listeners.push_back(std::make_shared<sum_listener>(sum));
+  perftest_emit("mutex + std::vector<std::shared_ptr<listener>> copy with concurrent connects",
+      [&]()
+      {
+        std::vector<std::shared_ptr<listener>> copy;
+        {
+          std::lock_guard<std::mutex> lock(m);
+          copy = listeners;
+        }
+        for (auto& l : copy) l->on_event(1);
+      },
+      [&]()
+      {
+        std::lock_guard<std::mutex> lock(m);
+        listeners.push_back(std::make_shared<sum_listener>(churn_sum));
+        listeners.pop_back();
+      });
+  ASSERT_NE(0, sum);
+}
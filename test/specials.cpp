@@ -1,5 +1,7 @@
 #include "ddw/impl.hpp"
+#include "fifo.h"
 #include <gtest/gtest.h>
+#include <vector>
 #include <dlfcn.h>
 
 namespace
@@ -59,6 +61,7 @@ struct TrackedA : A
 {
   TrackedA() : v(0) { Tracker::inst->default_constructed++; }
   TrackedA(int v) : v(v) { Tracker::inst->value_constructed++; }
+  TrackedA(int a, int b) : v(a + b) { Tracker::inst->value_constructed++; }
   TrackedA(const TrackedA& other) : v(other.v) { Tracker::inst->copy_constructed++; }
   TrackedA(TrackedA&& other) :v(other.v) { Tracker::inst->move_constructed++; }
   TrackedA& operator=(const TrackedA& other)
@@ -328,3 +331,75 @@ TEST(specials, convert_large_impl)
   ASSERT_EQ(1, mt.malloced);
   ASSERT_EQ(1, mt.freed);
 }
+
+TEST(specials, reset_to_null)
+{
+  MallocTracker mt;
+  Tracker t;
+  {
+    ddw::impl<A> a = SmallTrackedA(5);
+    a.reset();
+    ASSERT_FALSE(a);
+    ASSERT_EQ(2, t.destructed);
+  }
+  ASSERT_EQ(2, t.destructed);
+  ASSERT_EQ(0, mt.malloced);
+}
+
+TEST(specials, emplace_multiple_arguments)
+{
+  MallocTracker mt;
+  Tracker t;
+  {
+    ddw::impl<A> small = ddw::impl_emplace<SmallTrackedA>(40, 2);
+    ddw::impl<A> large = ddw::impl_emplace<LargeTrackedA>(30, 3);
+    ASSERT_EQ(42, small->value());
+    ASSERT_EQ(33, large->value());
+  }
+  ASSERT_EQ(2, t.value_constructed);
+  ASSERT_EQ(0, t.copy_constructed);
+  ASSERT_EQ(0, t.move_constructed);
+  ASSERT_EQ(2, t.destructed);
+  ASSERT_EQ(1, mt.malloced);
+}
+
+TEST(specials, emplace_into_queue)
+{
+  Tracker t;
+  {
+    auto q = std::make_unique<fifo<ddw::impl<A>, 16, 4>>();
+    q->push(ddw::impl_emplace<SmallTrackedA>(1, 2));
+    q->emplace<SmallTrackedA>(3, 4);
+    q->emplace<LargeTrackedA>(5, 6);
+    q->emplace<EmplaceOnly>(77);
+    q->push(ddw::impl_emplace<EmplaceOnly>(78));
+    q->flush();
+    for (int expected : {3, 7, 11, 77, 78})
+    {
+      ASSERT_EQ(expected, q->front()->value());
+      q->pop();
+    }
+  }
+  ASSERT_EQ(3, t.value_constructed);
+  ASSERT_EQ(0, t.copy_constructed);
+  ASSERT_EQ(0, t.move_constructed);
+  ASSERT_EQ(3, t.destructed);
+}
+
+TEST(specials, emplace_into_container)
+{
+  Tracker t;
+  {
+    std::vector<ddw::impl<A>> v;
+    v.reserve(3);
+    v.emplace_back(ddw::impl_emplace<SmallTrackedA>(1, 2));
+    v.emplace_back(ddw::impl_emplace<LargeTrackedA>(3, 4));
+    v.emplace_back(ddw::impl_emplace<EmplaceOnly>(5));
+    ASSERT_EQ(3, v[0]->value());
+    ASSERT_EQ(7, v[1]->value());
+    ASSERT_EQ(5, v[2]->value());
+  }
+  ASSERT_EQ(2, t.value_constructed);
+  ASSERT_EQ(0, t.move_constructed);
+  ASSERT_EQ(0, t.copy_constructed);
+}
@@ -0,0 +1,197 @@
+#include "ddw/impl.hpp"
+#include "spool.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct job
+{
+  virtual ~job() {}
+  virtual int weight() const = 0;
+};
+
+struct print_job : job
+{
+  print_job(int pages) : pages(pages) {}
+  int weight() const override { return pages; }
+  int pages;
+};
+
+struct named_job : job
+{
+  named_job(const char* s, std::size_t n) : len(n) { std::memcpy(name, s, n); }
+  int weight() const override { return len; }
+  std::size_t len;
+  char name[24];
+};
+
+using job_spool = spool<job>;
+
+void register_jobs()
+{
+  job_spool::register_type<print_job>(1,
+      [](const print_job& j, char* dst, std::size_t capacity) -> std::size_t {
+        if (sizeof(j.pages) <= capacity)
+          std::memcpy(dst, &j.pages, sizeof(j.pages));
+        return sizeof(j.pages);
+      },
+      [](const char* src, std::size_t, job_spool::value_type& dst) {
+        int pages;
+        std::memcpy(&pages, src, sizeof(pages));
+        dst.emplace<print_job>(pages);
+      });
+  job_spool::register_type<named_job>(2,
+      [](const named_job& j, char* dst, std::size_t capacity) -> std::size_t {
+        if (j.len <= capacity)
+          std::memcpy(dst, j.name, j.len);
+        return j.len;
+      },
+      [](const char* src, std::size_t n, job_spool::value_type& dst) {
+        dst.emplace<named_job>(src, n);
+      });
+}
+
+struct spool_file
+{
+  std::string path = "/tmp/ddw-spool-test-" + std::to_string(::getpid());
+  spool_file() { std::remove(path.c_str()); register_jobs(); }
+  ~spool_file() { std::remove(path.c_str()); }
+};
+
+}
+
+TEST(spool, survives_reopen)
+{
+  spool_file f;
+  {
+    job_spool s(f.path, 1 << 16);
+    for (int i = 1; i <= 1000; i++)
+      s.push(print_job(i));
+    s.push(named_job("report", 6));
+  }
+  job_spool s(f.path, 1 << 16);
+  std::vector<int> weights;
+  ASSERT_EQ(1001u, s.replay([&](job_spool::value_type& j) { weights.push_back(j->weight()); }));
+  ASSERT_EQ(1001u, weights.size());
+  for (int i = 1; i <= 1000; i++)
+    ASSERT_EQ(i, weights[i - 1]);
+  ASSERT_EQ(6, weights.back());
+  ASSERT_TRUE(s.empty());
+}
+
+TEST(spool, released_records_are_not_replayed)
+{
+  spool_file f;
+  {
+    job_spool s(f.path, 1 << 16);
+    for (int i = 0; i < 10; i++)
+      s.push(print_job(i));
+    s.flush();
+    int sum = 0;
+    s.replay([&](job_spool::value_type& j) { sum += j->weight(); });
+    ASSERT_EQ(45, sum);
+    s.push(print_job(100));
+  }
+  job_spool s(f.path, 1 << 16);
+  int sum = 0;
+  ASSERT_EQ(1u, s.replay([&](job_spool::value_type& j) { sum += j->weight(); }));
+  ASSERT_EQ(100, sum);
+}
+
+TEST(spool, wraps_around)
+{
+  spool_file f;
+  job_spool s(f.path, 4096);
+  int expected = 0;
+  int sum = 0;
+  for (int round = 0; round < 100; round++)
+  {
+    for (int i = 0; not s.full() and i < 50; i++)
+    {
+      s.push(print_job(i));
+      expected += i;
+    }
+    s.flush();
+    s.replay([&](job_spool::value_type& j) { sum += j->weight(); });
+    s.release();
+  }
+  ASSERT_EQ(expected, sum);
+}
+
+TEST(spool, rejects_push_when_full)
+{
+  spool_file f;
+  job_spool s(f.path, 4096);
+  int pushed = 0;
+  while (not s.full())
+  {
+    s.push(print_job(1));
+    pushed++;
+  }
+  ASSERT_THROW(s.push(print_job(2)), std::length_error);
+  s.flush();
+  int sum = 0;
+  s.replay([&](job_spool::value_type& j) { sum += j->weight(); });
+  ASSERT_EQ(pushed, sum);
+}
+
+TEST(spool, rejects_oversized_record)
+{
+  spool_file f;
+  using small_spool = spool<job, 32, sizeof(void*), 16>;
+  small_spool::register_type<named_job>(2,
+      [](const named_job& j, char* dst, std::size_t capacity) -> std::size_t {
+        if (j.len <= capacity)
+          std::memcpy(dst, j.name, j.len);
+        return j.len;
+      },
+      [](const char* src, std::size_t n, small_spool::value_type& dst) {
+        dst.emplace<named_job>(src, n);
+      });
+  small_spool s(f.path, 4096);
+  ASSERT_THROW(s.push(named_job("twenty bytes of name", 20)), std::logic_error);
+  s.push(named_job("short", 5));
+  s.flush();
+  int sum = 0;
+  ASSERT_EQ(1u, s.replay([&](small_spool::value_type& j) { sum += j->weight(); }));
+  ASSERT_EQ(5, sum);
+}
+
+TEST(perftest, spool_impl)
+{
+  spool_file f;
+  job_spool s(f.path, 1 << 24);
+  int counter = 0;
+  int expected_counter = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - t0 < 1s)
+  {
+    for (int i = 0; i < 10000; i++)
+    {
+      if (s.full())
+      {
+        s.flush();
+        s.replay([&](job_spool::value_type& j) { counter += j->weight(); });
+        s.release();
+      }
+      s.push(print_job(1));
+    }
+    expected_counter += 10000;
+  }
+  s.flush();
+  s.replay([&](job_spool::value_type& j) { counter += j->weight(); });
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << "spool holding small ddw::impl<job> objects processed " << counter * 1s / (t1 - t0) << " msgs per second.\n";
+
+  ASSERT_EQ(expected_counter, counter);
+}
@@ -0,0 +1,72 @@
+#include "ddw/impl.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+
+namespace
+{
+
+struct doc
+{
+  virtual ~doc() {}
+  virtual int print() const = 0;
+};
+
+struct null_doc : doc
+{
+  int print() const override { return 0; }
+};
+
+null_doc null_doc_instance;
+
+__attribute__((noinline)) doc& dynamic_instance()
+{
+  return null_doc_instance;
+}
+
+// Globals in a translation unit are dynamically initialized in order of
+// definition, so these bracket the initializers of the globals in between.
+std::chrono::steady_clock::time_point now()
+{
+  return std::chrono::steady_clock::now();
+}
+
+extern ddw::impl<doc> constant_000;
+// Runs before constant_000 would have been initialized dynamically.
+bool constant_seen_early = constant_000.has_impl();
+
+#define STARTUP_G10(G, n) G(n##0) G(n##1) G(n##2) G(n##3) G(n##4) G(n##5) G(n##6) G(n##7) G(n##8) G(n##9)
+#define STARTUP_G100(G, n) STARTUP_G10(G, n##0) STARTUP_G10(G, n##1) STARTUP_G10(G, n##2) STARTUP_G10(G, n##3) \
+  STARTUP_G10(G, n##4) STARTUP_G10(G, n##5) STARTUP_G10(G, n##6) STARTUP_G10(G, n##7) STARTUP_G10(G, n##8) \
+  STARTUP_G10(G, n##9)
+#define STARTUP_G1000(G) STARTUP_G100(G, 0) STARTUP_G100(G, 1) STARTUP_G100(G, 2) STARTUP_G100(G, 3) \
+  STARTUP_G100(G, 4) STARTUP_G100(G, 5) STARTUP_G100(G, 6) STARTUP_G100(G, 7) STARTUP_G100(G, 8) \
+  STARTUP_G100(G, 9)
+
+#define STARTUP_DYNAMIC(n) ddw::impl<doc> dynamic_##n = dynamic_instance();
+#define STARTUP_CONSTANT(n) ddw::impl<doc> constant_##n = null_doc_instance;
+
+auto dynamic_begin = now();
+STARTUP_G1000(STARTUP_DYNAMIC)
+auto dynamic_end = now();
+
+auto constant_begin = now();
+STARTUP_G1000(STARTUP_CONSTANT)
+auto constant_end = now();
+
+}
+
+TEST(specials, reference_is_constant_initialized)
+{
+  ASSERT_TRUE(constant_seen_early);
+  ASSERT_EQ(0, constant_000->print());
+  ASSERT_EQ(0, constant_999->print());
+  ASSERT_EQ(&null_doc_instance, dynamic_999.get());
+}
+
+TEST(perftest, startup_impl_globals)
+{
+  std::cout << "1000 impl globals referring to a singleton took "
+            << std::chrono::nanoseconds(dynamic_end - dynamic_begin).count() << " ns at startup when dynamically initialized and "
+            << std::chrono::nanoseconds(constant_end - constant_begin).count() << " ns when constant-initialized,\n"
+            << "  which leaves only the registration of their destructors.\n";
+}
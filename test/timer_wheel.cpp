@@ -0,0 +1,147 @@
+#include "ddw/impl.hpp"
+#include "timer_wheel.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct timer_task
+{
+  virtual ~timer_task() {}
+  virtual void fire(std::uint64_t now) = 0;
+};
+
+struct record_task : timer_task
+{
+  std::uint64_t due;
+  std::vector<std::uint64_t>& late;
+  record_task(std::uint64_t due, std::vector<std::uint64_t>& late) : due(due), late(late) {}
+  void fire(std::uint64_t now) override { if (now != due) late.push_back(due); }
+};
+
+struct count_task : timer_task
+{
+  long& counter;
+  count_task(long& c) : counter(c) {}
+  void fire(std::uint64_t) override { counter++; }
+};
+
+using wheel = timer_wheel<timer_task>;
+
+}
+
+TEST(timer_wheel, fires_on_time)
+{
+  wheel w;
+  std::vector<std::uint64_t> late;
+  std::mt19937 gen(1);
+  std::vector<std::uint64_t> delays = {1, 2, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 1 << 24, (1 << 24) + 5};
+  for (int i = 0; i < 1000; i++)
+    delays.push_back(gen() % 300000);
+  for (auto d : delays)
+    w.schedule_emplace<record_task>(d, d ? d : 1, late);
+  std::size_t fired = 0;
+  while (w.size() != 0)
+    fired += w.advance(1000, [&w](wheel::value_type& t) { t->fire(w.current_tick()); });
+  ASSERT_EQ(delays.size(), fired);
+  ASSERT_TRUE(late.empty());
+}
+
+TEST(timer_wheel, cancel)
+{
+  wheel w;
+  long counter = 0;
+  auto h1 = w.schedule(10, count_task(counter));
+  auto h2 = w.schedule(5000, count_task(counter));
+  w.schedule(20, count_task(counter));
+  ASSERT_TRUE(w.cancel(h1));
+  ASSERT_FALSE(w.cancel(h1));
+  auto h3 = w.schedule(10, count_task(counter));
+  ASSERT_FALSE(w.cancel(h1));
+  w.advance(100, [&w](wheel::value_type& t) { t->fire(w.current_tick()); });
+  ASSERT_EQ(2, counter);
+  ASSERT_FALSE(w.cancel(h3));
+  ASSERT_TRUE(w.cancel(h2));
+  ASSERT_EQ(0u, w.size());
+}
+
+TEST(timer_wheel, schedule_from_handler)
+{
+  wheel w;
+  long counter = 0;
+  w.schedule(64, count_task(counter));
+  w.advance(64, [&](wheel::value_type& t) {
+    t->fire(w.current_tick());
+    if (counter < 10) w.schedule(64, count_task(counter));
+  });
+  ASSERT_EQ(1, counter);
+  w.advance(64 * 20, [&](wheel::value_type& t) {
+    t->fire(w.current_tick());
+    if (counter < 10) w.schedule(64, count_task(counter));
+  });
+  ASSERT_EQ(10, counter);
+}
+
+namespace
+{
+
+const int timer_count = 1000000;
+
+std::vector<std::uint64_t> random_delays()
+{
+  std::vector<std::uint64_t> delays(timer_count);
+  std::mt19937 gen(7);
+  for (auto& d : delays)
+    d = 1 + gen() % 100000;
+  return delays;
+}
+
+}
+
+TEST(perftest, timer_wheel_impl)
+{
+  auto delays = random_delays();
+  wheel w;
+  long counter = 0;
+  std::vector<wheel::handle> handles(timer_count);
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < timer_count; i++)
+    handles[i] = w.schedule(delays[i], count_task(counter));
+  for (int i = 0; i < timer_count; i += 2)
+    w.cancel(handles[i]);
+  w.advance(100000, [&w](wheel::value_type& t) { t->fire(w.current_tick()); });
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << "timer_wheel holding small ddw::impl<timer_task> objects processed " << timer_count * 1s / (t1 - t0) << " timers per second.\n";
+
+  ASSERT_EQ(timer_count / 2, counter);
+}
+
+TEST(perftest, timer_priority_queue_std_function)
+{
+  using entry = std::pair<std::uint64_t, std::function<void()>>;
+  auto later = [](const entry& a, const entry& b) { return a.first > b.first; };
+  auto delays = random_delays();
+  std::priority_queue<entry, std::vector<entry>, decltype(later)> q(later);
+  long counter = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < timer_count; i++)
+    q.emplace(delays[i], [capt = count_task(counter)]() mutable { capt.fire(0); });
+  while (not q.empty())
+  {
+    const_cast<entry&>(q.top()).second();
+    q.pop();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  std::cout << "std::priority_queue holding std::function<void()> objects processed " << timer_count * 1s / (t1 - t0) << " timers per second.\n";
+
+  ASSERT_EQ(timer_count, counter);
+}
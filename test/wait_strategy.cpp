@@ -0,0 +1,128 @@
+#include "ddw/impl.hpp"
+#include "fifo.h"
+#include "wait_strategy.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+using namespace std::literals::chrono_literals;
+
+namespace
+{
+
+struct msg
+{
+  virtual ~msg() {}
+  virtual std::chrono::steady_clock::time_point sent() const = 0;
+};
+
+struct stamped_msg : msg
+{
+  std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point sent() const override { return t; }
+};
+
+using queue = fifo<ddw::impl<msg>, 1024, 64>;
+
+std::chrono::nanoseconds thread_cpu_time()
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+// Sends count messages, spaced by gap, and reports how long after being
+// published each one was picked up, and how much cpu time the consumer
+// used per second of waiting on an idle queue.
+template<typename Wait>
+void run_wait(const char* name, long count, std::chrono::microseconds gap)
+{
+  auto q = std::make_unique<queue>();
+  Wait w;
+  std::vector<std::chrono::nanoseconds> latency(count);
+  std::chrono::nanoseconds consumer_cpu{};
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread consumer([&]()
+  {
+    auto cpu0 = thread_cpu_time();
+    for (long i = 0; i < count; i++)
+    {
+      w.wait([&]() { return not q->empty(); });
+      latency[i] = std::chrono::steady_clock::now() - q->front()->sent();
+      q->pop();
+    }
+    consumer_cpu = thread_cpu_time() - cpu0;
+  });
+  for (long i = 0; i < count; i++)
+  {
+    std::this_thread::sleep_for(gap);
+    q->push(stamped_msg());
+    q->flush();
+    w.notify();
+  }
+  consumer.join();
+  auto t1 = std::chrono::steady_clock::now();
+  std::sort(latency.begin(), latency.end());
+  std::cout << name << " woke up after p50 " << latency[count / 2].count() << " ns and p99 "
+            << latency[count * 99 / 100].count() << " ns, using " << consumer_cpu * 100 / (t1 - t0)
+            << "% cpu while mostly idle.\n";
+}
+
+}
+
+TEST(wait_strategy, futex_wait_delivers_all)
+{
+  const long count = 1000000;
+  auto q = std::make_unique<queue>();
+  futex_wait<> w;
+  long received = 0;
+  std::thread consumer([&]()
+  {
+    while (received < count)
+    {
+      w.wait([&]() { return not q->empty(); });
+      q->pop();
+      received++;
+    }
+  });
+  for (long i = 0; i < count; i++)
+  {
+    while (q->full())
+      std::this_thread::yield();
+    q->push(stamped_msg());
+    if (i % 64 == 0)
+    {
+      q->flush();
+      w.notify();
+    }
+  }
+  q->flush();
+  w.notify();
+  consumer.join();
+  ASSERT_EQ(count, received);
+  ASSERT_LT(w.wakes, std::uint64_t(count / 64 + 1));
+}
+
+TEST(perftest, wait_sleep)
+{
+  run_wait<sleep_wait>("sleep_for(1us) polling", 2000, 100us);
+}
+
+TEST(perftest, wait_spin)
+{
+  run_wait<spin_wait>("pause spinning", 2000, 100us);
+}
+
+TEST(perftest, wait_spin_yield)
+{
+  run_wait<spin_yield_wait<>>("spin-then-yield", 2000, 100us);
+}
+
+TEST(perftest, wait_futex)
+{
+  run_wait<futex_wait<>>("spin-then-futex", 2000, 100us);
+}